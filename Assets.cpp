@@ -0,0 +1,301 @@
+//
+//  Assets.cpp
+//  Chess
+//
+
+#include "Assets.h"
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+using namespace std;
+
+const char* ASSET_FILES[NUM_TEXTURES] = {
+    "king_white.png", "king_black.png",
+    "queen_white.png", "queen_black.png",
+    "rook_white.png", "rook_black.png",
+    "bishop_white.png", "bishop_black.png",
+    "knight_white.png", "knight_black.png",
+    "pawn_white.png", "pawn_black.png",
+    "button_vsPlayer.png", "button_vsComputer.png",
+    "banner_whiteWins.png", "banner_blackWins.png", "banner_draw.png",
+    "button_exit.png",
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR/DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////
+AssetStore::AssetStore()
+ : m_nextJob(0)
+{
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        m_width[i] = 0;
+        m_height[i] = 0;
+        m_pixels[i] = nullptr;
+        m_order[i] = i;
+        m_decoded[i] = false;
+    }
+}
+
+AssetStore::~AssetStore()
+{
+    release();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// LOADING
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool AssetStore::load(const string& baseDir, const int* decodeOrder)
+{
+    if (loadPack(baseDir + "/assets.pack"))
+    {
+        traceStartup("mapped assets.pack");
+        return true;
+    }
+    return startPNGs(baseDir + "/assets", decodeOrder);
+}
+
+bool AssetStore::loadPack(const string& path)
+{
+    release();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)(sizeof(PackHeader) + NUM_TEXTURES * sizeof(PackEntry)))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const unsigned char* base = static_cast<const unsigned char*>(map);
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(base);
+    const PackEntry* entries = reinterpret_cast<const PackEntry*>(base + sizeof(PackHeader));
+    bool valid = memcmp(header->magic, PACK_MAGIC, 4) == 0 && header->version == PACK_VERSION && header->count == NUM_TEXTURES;
+    for (int i = 0; valid && i < NUM_TEXTURES; i++)
+    {
+        uint64_t bytes = uint64_t(entries[i].width) * entries[i].height * 4;
+        valid = entries[i].offset <= size && bytes <= size - entries[i].offset;
+    }
+    if (!valid)
+    {
+        cerr << path << " is not a valid asset pack, rebuild it with tools/packassets" << endl;
+        munmap(map, size);
+        return false;
+    }
+
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        m_width[i] = entries[i].width;
+        m_height[i] = entries[i].height;
+        m_pixels[i] = base + entries[i].offset;
+        m_decoded[i] = true;
+    }
+    m_map = map;
+    m_mapSize = size;
+    return true;
+}
+
+bool AssetStore::startPNGs(const string& dir, const int* decodeOrder)
+{
+    release();
+
+    // Sizes come from the headers alone, so the atlas can be laid out before anything is decoded
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        string path = dir + "/" + ASSET_FILES[i];
+        int channels;
+        if (!stbi_info(path.c_str(), &m_width[i], &m_height[i], &channels))
+        {
+            cerr << "Texture " << path << " not found!" << endl;
+            return false;
+        }
+        m_order[i] = decodeOrder != nullptr ? decodeOrder[i] : i;
+        m_decoded[i] = false;
+    }
+    traceStartup("read PNG headers");
+
+    m_dir = dir;
+    m_nextJob = 0;
+    int threads = max(1, min<int>(ASSET_THREADS, thread::hardware_concurrency()));
+    for (int t = 0; t < threads; t++)
+    {
+        m_workers.push_back(thread(&AssetStore::decodeWorker, this));
+    }
+    return true;
+}
+
+bool AssetStore::loadPNGs(const string& dir)
+{
+    if (!startPNGs(dir) || !waitFor(0, NUM_TEXTURES - 1))
+    {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void AssetStore::decodeWorker()
+{
+    // GL wants the bottom row first
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    // Jobs are taken in m_order, so the images the first screen needs come out first
+    for (int job = m_nextJob++; job < NUM_TEXTURES; job = m_nextJob++)
+    {
+        int i = m_order[job];
+        string path = m_dir + "/" + ASSET_FILES[i];
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        if (pixels != nullptr && (width != m_width[i] || height != m_height[i]))
+        {
+            stbi_image_free(pixels);
+            pixels = nullptr;
+        }
+        if (pixels == nullptr)
+        {
+            cerr << "Texture " << path << " could not be decoded!" << endl;
+        }
+        traceStartup("decoded", i);
+
+        lock_guard<mutex> lock(m_mutex);
+        m_pixels[i] = pixels;
+        m_decoded[i] = true;
+        m_decodedCV.notify_all();
+    }
+}
+
+bool AssetStore::waitFor(int first, int last)
+{
+    unique_lock<mutex> lock(m_mutex);
+    bool ok = true;
+    for (int i = first; i <= last; i++)
+    {
+        m_decodedCV.wait(lock, [this, i] { return m_decoded[i]; });
+        ok = ok && m_pixels[i] != nullptr;
+    }
+    return ok;
+}
+
+void AssetStore::joinWorkers()
+{
+    for (size_t t = 0; t < m_workers.size(); t++)
+    {
+        m_workers[t].join();
+    }
+    m_workers.clear();
+}
+
+void AssetStore::releaseImage(int i)
+{
+    if (m_map == nullptr)
+    {
+        stbi_image_free(const_cast<unsigned char*>(m_pixels[i]));
+        m_pixels[i] = nullptr;
+    }
+}
+
+void AssetStore::release()
+{
+    joinWorkers();
+    if (m_map != nullptr)
+    {
+        munmap(m_map, m_mapSize);
+        m_map = nullptr;
+        m_mapSize = 0;
+    }
+    else
+    {
+        for (int i = 0; i < NUM_TEXTURES; i++)
+        {
+            stbi_image_free(const_cast<unsigned char*>(m_pixels[i]));
+        }
+    }
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        m_pixels[i] = nullptr;
+        m_decoded[i] = false;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// STARTUP TRACE
+////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef TRACE_STARTUP
+static const chrono::steady_clock::time_point STARTUP_TIME = chrono::steady_clock::now();
+
+void traceStartup(const char* event, int index)
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - STARTUP_TIME;
+    if (index >= 0)
+    {
+        fprintf(stderr, "[startup %8.3f ms] %s %s\n", elapsed.count(), event, ASSET_FILES[index]);
+    }
+    else
+    {
+        fprintf(stderr, "[startup %8.3f ms] %s\n", elapsed.count(), event);
+    }
+}
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// PATHS
+////////////////////////////////////////////////////////////////////////////////////////////////
+string executableDir(const char* argv0)
+{
+    // Ask the system where the binary is, since argv[0] has no directory when it was found through PATH
+    string path;
+    char buffer[PATH_MAX];
+#if defined(__APPLE__)
+    uint32_t size = sizeof(buffer);
+    char resolved[PATH_MAX];
+    if (_NSGetExecutablePath(buffer, &size) == 0 && realpath(buffer, resolved) != nullptr)
+    {
+        path = resolved;
+    }
+#elif defined(__linux__)
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+    if (length > 0)
+    {
+        path.assign(buffer, length);
+    }
+#endif
+    if (path.empty() && argv0 != nullptr)
+    {
+        path = argv0;
+    }
+    size_t slash = path.find_last_of('/');
+    if (slash == string::npos)
+    {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
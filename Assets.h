@@ -0,0 +1,129 @@
+//
+//  Assets.h
+//  Chess
+//
+
+#ifndef ASSETS_INCLUDED
+#define ASSETS_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "globals.h"
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// ASSET PACK FORMAT
+////////////////////////////////////////////////////////////////////////////////////////////////
+// assets.pack, written by tools/packassets.cpp: a PackHeader, NUM_TEXTURES PackEntry records in
+// texture index order, then the raw RGBA pixels of every image. Rows are stored bottom first, the
+// order glTexImage2D expects, so the runtime can hand the mapped bytes straight to GL.
+const char PACK_MAGIC[4] = {'C', 'H', 'P', 'K'};
+const uint32_t PACK_VERSION = 1;
+
+struct PackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;     // Always NUM_TEXTURES
+    uint32_t reserved;
+};
+
+struct PackEntry
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;    // From the start of the file
+};
+
+extern const char* ASSET_FILES[NUM_TEXTURES]; // PNG file names under assets/, indexed like the textures
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// ASSET STORE
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Holds the RGBA pixels of every image until they have been uploaded. They come either from
+// a memory-mapped asset pack (no decoding, one open) or, when there is no pack, from the PNGs.
+// PNGs are decoded in the background by a few worker threads; sizes are known as soon as
+// load() returns, pixels once waitFor() has returned for them.
+class AssetStore
+{
+public:
+    AssetStore();
+    ~AssetStore();
+    AssetStore(const AssetStore&) = delete;
+    AssetStore& operator=(const AssetStore&) = delete;
+
+    bool load(const std::string& baseDir, const int* decodeOrder = nullptr); // Tries baseDir/assets.pack, then starts decoding baseDir/assets/*.png, most urgent first if decodeOrder lists all texture indices.
+    bool loadPack(const std::string& path);
+    bool startPNGs(const std::string& dir, const int* decodeOrder = nullptr); // Reads every PNG's size and returns; the pixels are decoded in the background.
+    bool loadPNGs(const std::string& dir); // startPNGs, then waits for all of them.
+    bool waitFor(int first, int last); // Blocks until images first..last are decoded. Returns false if any of them failed.
+    void releaseImage(int i); // Frees one decoded image once it has been uploaded. A no-op for the pack.
+    void release(); // Frees decoded pixels or unmaps the pack. The accessors are invalid afterwards.
+
+    bool fromPack() const;
+    int width(int i) const;
+    int height(int i) const;
+    const unsigned char* pixels(int i) const; // width * height * 4 bytes, bottom row first
+
+private:
+    void decodeWorker();
+    void joinWorkers();
+
+    int m_width[NUM_TEXTURES];
+    int m_height[NUM_TEXTURES];
+    const unsigned char* m_pixels[NUM_TEXTURES];
+
+    void* m_map = nullptr; // The mapped pack, if the pixels point into it
+    size_t m_mapSize = 0;
+
+    // PNG decoding
+    std::string m_dir;
+    int m_order[NUM_TEXTURES];
+    std::atomic<int> m_nextJob;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_decodedCV;
+    bool m_decoded[NUM_TEXTURES]; // Guarded by m_mutex
+};
+
+std::string executableDir(const char* argv0); // Directory holding the running binary. Falls back on argv[0]'s directory, or ".", where the system can't say.
+
+// Prints the time since startup and what just happened, when built with -DTRACE_STARTUP.
+#ifdef TRACE_STARTUP
+void traceStartup(const char* event, int index = -1);
+#else
+inline void traceStartup(const char*, int = -1) {}
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ACCESSORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline bool AssetStore::fromPack() const
+{
+    return m_map != nullptr;
+}
+
+inline int AssetStore::width(int i) const
+{
+    return m_width[i];
+}
+
+inline int AssetStore::height(int i) const
+{
+    return m_height[i];
+}
+
+inline const unsigned char* AssetStore::pixels(int i) const
+{
+    return m_pixels[i];
+}
+
+#endif /* ASSETS_INCLUDED */
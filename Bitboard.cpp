@@ -0,0 +1,73 @@
+//
+//  Bitboard.cpp
+//  Chess
+//
+
+#include "Bitboard.h"
+#include <cstdlib>
+#include <mutex>
+using namespace std;
+
+Bitboard KNIGHT_ATTACKS[64];
+Bitboard KING_ATTACKS[64];
+Bitboard PAWN_ATTACKS[2][64];
+Bitboard RAYS[8][64];
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// initBitboards
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the square (row + dr, col + dc) as a bitboard, or 0 if it is off the board
+static Bitboard offsetBB(int row, int col, int dr, int dc)
+{
+    int r = row + dr;
+    int c = col + dc;
+    return (r >= 1 && r <= 8 && c >= 1 && c <= 8) ? squareBB(makeSquare(r, c)) : 0;
+}
+
+static void fillBitboards()
+{
+    const int rayDR[8] = {NORTH, 0, NORTH, NORTH, SOUTH, 0, SOUTH, SOUTH};
+    const int rayDC[8] = {0, EAST, EAST, WEST, 0, WEST, EAST, WEST};
+
+    for (int sq = 0; sq < 64; sq++)
+    {
+        int row = squareRow(sq);
+        int col = squareCol(sq);
+
+        KNIGHT_ATTACKS[sq] = 0;
+        KING_ATTACKS[sq] = 0;
+        for (int dr = -2; dr <= 2; dr++)
+        {
+            for (int dc = -2; dc <= 2; dc++)
+            {
+                if (abs(dr) + abs(dc) == 3)
+                {
+                    KNIGHT_ATTACKS[sq] |= offsetBB(row, col, dr, dc);
+                }
+                if (abs(dr) <= 1 && abs(dc) <= 1 && (dr != 0 || dc != 0))
+                {
+                    KING_ATTACKS[sq] |= offsetBB(row, col, dr, dc);
+                }
+            }
+        }
+
+        PAWN_ATTACKS[WHITE][sq] = offsetBB(row, col, NORTH, EAST) | offsetBB(row, col, NORTH, WEST);
+        PAWN_ATTACKS[BLACK][sq] = offsetBB(row, col, SOUTH, EAST) | offsetBB(row, col, SOUTH, WEST);
+
+        for (int ray = 0; ray < 8; ray++)
+        {
+            RAYS[ray][sq] = 0;
+            for (int step = 1; step < 8; step++)
+            {
+                RAYS[ray][sq] |= offsetBB(row, col, step * rayDR[ray], step * rayDC[ray]);
+            }
+        }
+    }
+}
+
+void initBitboards()
+{
+    static once_flag once;
+    call_once(once, fillBitboards);
+}
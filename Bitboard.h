@@ -0,0 +1,183 @@
+//
+//  Bitboard.h
+//  Chess
+//
+
+#ifndef BITBOARD_INCLUDED
+#define BITBOARD_INCLUDED
+
+#include <cstdint>
+#include "globals.h"
+
+typedef uint64_t Bitboard; // Bit (row - 1) * 8 + (col - 1) is set for each occupied square, so a1 is bit 0 and h8 is bit 63.
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// SQUARES
+////////////////////////////////////////////////////////////////////////////////////////////////
+const int NO_SQUARE = -1;
+
+inline int makeSquare(int row, int col)
+{
+    return (row - 1) * 8 + (col - 1);
+}
+
+inline int squareRow(int sq)
+{
+    return (sq >> 3) + 1;
+}
+
+inline int squareCol(int sq)
+{
+    return (sq & 7) + 1;
+}
+
+inline Bitboard squareBB(int sq)
+{
+    return 1ULL << sq;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// MASKS
+////////////////////////////////////////////////////////////////////////////////////////////////
+const Bitboard FILE_A_BB = 0x0101010101010101ULL;
+const Bitboard FILE_H_BB = FILE_A_BB << 7;
+
+const Bitboard RANK_1_BB = 0xFFULL;
+const Bitboard RANK_2_BB = RANK_1_BB << 8;
+const Bitboard RANK_3_BB = RANK_1_BB << 16;
+const Bitboard RANK_6_BB = RANK_1_BB << 40;
+const Bitboard RANK_7_BB = RANK_1_BB << 48;
+const Bitboard RANK_8_BB = RANK_1_BB << 56;
+
+// Shift amounts for moving every bit of a bitboard one step in a direction
+const int SHIFT_NORTH = 8;
+const int SHIFT_SOUTH = -8;
+const int SHIFT_EAST = 1;
+const int SHIFT_WEST = -1;
+const int SHIFT_NORTH_EAST = 9;
+const int SHIFT_NORTH_WEST = 7;
+const int SHIFT_SOUTH_EAST = -7;
+const int SHIFT_SOUTH_WEST = -9;
+
+// Returns b shifted one step in the Shift direction; bits that would wrap around the board's edge are dropped.
+template<int Shift>
+inline Bitboard shift(Bitboard b)
+{
+    return Shift == SHIFT_NORTH      ? b << 8
+         : Shift == SHIFT_SOUTH      ? b >> 8
+         : Shift == SHIFT_EAST       ? (b & ~FILE_H_BB) << 1
+         : Shift == SHIFT_WEST       ? (b & ~FILE_A_BB) >> 1
+         : Shift == SHIFT_NORTH_EAST ? (b & ~FILE_H_BB) << 9
+         : Shift == SHIFT_NORTH_WEST ? (b & ~FILE_A_BB) << 7
+         : Shift == SHIFT_SOUTH_EAST ? (b & ~FILE_H_BB) >> 7
+         : Shift == SHIFT_SOUTH_WEST ? (b & ~FILE_A_BB) >> 9
+         : 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// SIDE TRAITS
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Everything that depends on the side to move, as compile-time constants. Code templated on Us
+// reads these instead of branching on color().
+template<int Us>
+struct Side
+{
+    static const int Them = Us == WHITE ? BLACK : WHITE;
+
+    static const int RowDir = Us == WHITE ? NORTH : SOUTH;
+    static const int Up = Us == WHITE ? SHIFT_NORTH : SHIFT_SOUTH;
+    static const int UpEast = Us == WHITE ? SHIFT_NORTH_EAST : SHIFT_SOUTH_EAST;
+    static const int UpWest = Us == WHITE ? SHIFT_NORTH_WEST : SHIFT_SOUTH_WEST;
+
+    static const int BackRow = Us == WHITE ? 1 : 8;
+    static const int PawnRow = Us == WHITE ? 2 : 7;
+    static const int EnPassantRow = Us == WHITE ? 5 : 4; // Row a pawn must stand on to capture en passant
+    static const int PromotionRow = Us == WHITE ? 8 : 1;
+
+    static const Bitboard DoublePushRank = Us == WHITE ? RANK_3_BB : RANK_6_BB; // Rank a pawn passes through on its double push
+    static const Bitboard PrePromotionRank = Us == WHITE ? RANK_7_BB : RANK_2_BB;
+
+    static const int KingStart = Us == WHITE ? 4 : 60; // e1 / e8
+    static const int KingSideRights = Us == WHITE ? WHITE_OO : BLACK_OO;
+    static const int QueenSideRights = Us == WHITE ? WHITE_OOO : BLACK_OOO;
+    static const Bitboard KingSidePath = Us == WHITE ? 0x60ULL : 0x60ULL << 56; // f and g, must be empty
+    static const Bitboard QueenSidePath = Us == WHITE ? 0x0EULL : 0x0EULL << 56; // b, c and d, must be empty
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// ATTACKS
+////////////////////////////////////////////////////////////////////////////////////////////////
+extern Bitboard KNIGHT_ATTACKS[64];
+extern Bitboard KING_ATTACKS[64];
+extern Bitboard PAWN_ATTACKS[2][64]; // Squares a pawn of the given color on sq attacks
+extern Bitboard RAYS[8][64]; // Squares from sq to the edge of the board in each direction, excluding sq
+
+void initBitboards(); // Fills the attack tables. Safe to call more than once, from any thread.
+
+inline int popcount(Bitboard b)
+{
+    return __builtin_popcountll(b);
+}
+
+inline int lsb(Bitboard b)
+{
+    return __builtin_ctzll(b);
+}
+
+inline int msb(Bitboard b)
+{
+    return 63 - __builtin_clzll(b);
+}
+
+inline int popLsb(Bitboard& b)
+{
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+// Ray directions, indexed into RAYS. The first four point towards higher squares, the last four towards lower ones.
+const int RAY_NORTH = 0;
+const int RAY_EAST = 1;
+const int RAY_NORTH_EAST = 2;
+const int RAY_NORTH_WEST = 3;
+const int RAY_SOUTH = 4;
+const int RAY_WEST = 5;
+const int RAY_SOUTH_EAST = 6;
+const int RAY_SOUTH_WEST = 7;
+
+// Attacks along one ray, stopping at (and including) the first occupied square.
+template<int Ray>
+inline Bitboard rayAttacks(int sq, Bitboard occupied)
+{
+    Bitboard attacks = RAYS[Ray][sq];
+    Bitboard blockers = attacks & occupied;
+    if (blockers)
+    {
+        attacks ^= RAYS[Ray][Ray < RAY_SOUTH ? lsb(blockers) : msb(blockers)];
+    }
+    return attacks;
+}
+
+inline Bitboard rookAttacks(int sq, Bitboard occupied)
+{
+    return rayAttacks<RAY_NORTH>(sq, occupied) | rayAttacks<RAY_EAST>(sq, occupied)
+         | rayAttacks<RAY_SOUTH>(sq, occupied) | rayAttacks<RAY_WEST>(sq, occupied);
+}
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied)
+{
+    return rayAttacks<RAY_NORTH_EAST>(sq, occupied) | rayAttacks<RAY_NORTH_WEST>(sq, occupied)
+         | rayAttacks<RAY_SOUTH_EAST>(sq, occupied) | rayAttacks<RAY_SOUTH_WEST>(sq, occupied);
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occupied)
+{
+    return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+}
+
+#endif /* BITBOARD_INCLUDED */
@@ -7,39 +7,218 @@
 
 #include "Board.h"
 #include "globals.h"
-#include "Engine.h"
+#include "MoveGen.h"
+#include "Evaluate.h"
+#include <algorithm>
+#include <sstream>
 #include <string>
 using namespace std;
 
+// Returns the castling rights that survive a move touching sq: moving the king or a rook, or capturing a rook, gives them up
+static int castlingMask(int sq)
+{
+    switch (sq)
+    {
+        case 0:  return ALL_CASTLING & ~WHITE_OOO;              // a1
+        case 4:  return ALL_CASTLING & ~(WHITE_OO | WHITE_OOO); // e1
+        case 7:  return ALL_CASTLING & ~WHITE_OO;               // h1
+        case 56: return ALL_CASTLING & ~BLACK_OOO;              // a8
+        case 60: return ALL_CASTLING & ~(BLACK_OO | BLACK_OOO); // e8
+        case 63: return ALL_CASTLING & ~BLACK_OO;               // h8
+        default: return ALL_CASTLING;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // Constructor
 ////////////////////////////////////////////////////////////////////////////////////////////////
 Board::Board()
+{
+    initBitboards();
+    initZobrist();
+    initPSQ();
+    clear();
+    placePieces(WHITE);
+    placePieces(BLACK);
+    
+    StateInfo& st = state();
+    st.castlingRights = ALL_CASTLING;
+    st.key = computeKey();
+    st.pawnKey = computePawnKey();
+}
+
+// Empties the board and its history, leaving white to move with no castling rights
+void Board::clear()
 {
     for (int row = 0; row < 8; row++)
     {
         for (int col = 0; col < 8; col++)
         {
-            m_piecePositions[row][col] = nullptr;
+            m_pieceIndex[row][col] = -1;
         }
     }
-    placePieces(WHITE);
-    placePieces(BLACK);
+    m_numPieces[WHITE] = 0;
+    m_numPieces[BLACK] = 0;
+    m_byColor[WHITE] = 0;
+    m_byColor[BLACK] = 0;
+    for (int type = 0; type < NUM_PIECE_TYPES; type++)
+    {
+        m_byType[type] = 0;
+    }
+    for (int pieceID = 0; pieceID < 12; pieceID++)
+    {
+        m_pieceCount[pieceID] = 0;
+    }
+    m_psqMg = 0;
+    m_psqEg = 0;
+    m_phase = 0;
+    m_materialKey = 0;
+    m_totalMoves = 0;
+    m_promotionPending = false;
+    m_stateIndex = 0;
+
+    StateInfo& st = state();
+    st.move = MOVE_NONE;
+    st.capturedID = -1;
+    st.castlingRights = 0;
+    st.epSquare = NO_SQUARE;
+    st.rule50 = 0;
+    st.key = 0;
+    st.pawnKey = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// Destructor
+// setFen
 ////////////////////////////////////////////////////////////////////////////////////////////////
-Board::~Board()
+bool Board::setFen(const string& fen)
 {
-    while (!m_white.empty())
+    static const string PIECE_CHARS = "KkQqRrBbNnPp"; // Indexed by pieceID
+
+    clear();
+    istringstream in(fen);
+    string placement, side, castling, ep;
+    int rule50 = 0;
+    int fullMoves = 1;
+    if (!(in >> placement >> side) || (side != "w" && side != "b"))
+    {
+        return false;
+    }
+    in >> castling >> ep >> rule50 >> fullMoves; // Missing trailing fields keep their defaults
+
+    int pieceAt[64];
+    int row = 8;
+    int col = 1;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        pieceAt[sq] = -1;
+    }
+    for (char c : placement)
     {
-        m_white.pop_back();
+        size_t pieceID = PIECE_CHARS.find(c);
+        if (c == '/')
+        {
+            row--;
+            col = 1;
+        }
+        else if (c >= '1' && c <= '8')
+        {
+            col += c - '0';
+        }
+        else if (pieceID != string::npos && row >= 1 && col <= 8)
+        {
+            pieceAt[makeSquare(row, col)] = int(pieceID);
+            col++;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    int rights = 0;
+    for (char c : castling)
+    {
+        rights |= c == 'K' ? WHITE_OO : c == 'Q' ? WHITE_OOO : c == 'k' ? BLACK_OO : c == 'q' ? BLACK_OOO : 0;
     }
-    while (!m_black.empty())
+    int epSq = NO_SQUARE;
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] >= '1' && ep[1] <= '8')
     {
-        m_black.pop_back();
+        epSq = makeSquare(ep[1] - '0', ep[0] - 'a' + 1);
     }
+    return setPosition(pieceAt, side == "b" ? BLACK : WHITE, rights, epSq, rule50, fullMoves);
+}
+
+bool Board::setPosition(const int pieceAt[64], int sideToMove, int castlingRights, int epSquare, int rule50, int fullMoves)
+{
+    clear();
+    Bitboard occupied[2] = {0, 0};
+    Bitboard kings = 0;
+    for (int sq = 0; sq < 64; sq++)
+    {
+        int pieceID = pieceAt[sq];
+        if (pieceID >= 12)
+        {
+            return false;
+        }
+        if (pieceID >= 0)
+        {
+            occupied[pieceID & 1] |= squareBB(sq);
+            kings |= pieceID / 2 == KING_ID / 2 ? squareBB(sq) : 0;
+        }
+    }
+    if (popcount(kings & occupied[WHITE]) != 1 || popcount(kings & occupied[BLACK]) != 1
+        || popcount(occupied[WHITE]) > MAX_PIECES || popcount(occupied[BLACK]) > MAX_PIECES)
+    {
+        return false;
+    }
+
+    // The king has to be added before the rest of its side, so it lands in slot 0
+    Bitboard others = (occupied[WHITE] | occupied[BLACK]) & ~kings;
+    while (kings)
+    {
+        int sq = popLsb(kings);
+        addPiece(squareRow(sq), squareCol(sq), pieceAt[sq] & 1, pieceAt[sq]);
+    }
+    while (others)
+    {
+        int sq = popLsb(others);
+        addPiece(squareRow(sq), squareCol(sq), pieceAt[sq] & 1, pieceAt[sq]);
+    }
+
+    // Drop castling rights the pieces can no longer have, as doMove would have
+    StateInfo& st = state();
+    st.castlingRights = castlingRights & ALL_CASTLING;
+    if (kingSquare(WHITE) != 4)
+    {
+        st.castlingRights &= ~(WHITE_OO | WHITE_OOO);
+    }
+    if (kingSquare(BLACK) != 60)
+    {
+        st.castlingRights &= ~(BLACK_OO | BLACK_OOO);
+    }
+    const int rookSquares[4] = {7, 0, 63, 56}; // h1, a1, h8, a8, in the order of the right bits
+    for (int i = 0; i < 4; i++)
+    {
+        if (pieceIDAt(rookSquares[i]) != ROOK_ID + (i >> 1))
+        {
+            st.castlingRights &= ~(1 << i);
+        }
+    }
+
+    m_totalMoves = 2 * max(fullMoves - 1, 0) + (sideToMove == BLACK ? BLACK : WHITE);
+    st.rule50 = max(rule50, 0);
+
+    // Like doMove, only keep an en passant square that an enemy pawn can actually use
+    int epRank = sideToMove == BLACK ? 3 : 6;
+    if (epSquare >= 0 && epSquare < 64 && squareRow(epSquare) == epRank
+        && (PAWN_ATTACKS[sideToMove ^ 1][epSquare] & piecesBB(PAWN_ID + sideToMove)))
+    {
+        st.epSquare = epSquare;
+    }
+
+    st.key = computeKey();
+    st.pawnKey = computePawnKey();
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -47,134 +226,182 @@ Board::~Board()
 ////////////////////////////////////////////////////////////////////////////////////////////////
 void Board::placePieces(int color)
 {
-    vector<Piece*>* pieceSet = color ? &m_black : &m_white;
-    King** kingPointer = color ? &m_blackKing : &m_whiteKing;
     int pawnRow = color ? 7 : 2;
     int backRow = color ? 8 : 1;
 
-    for (int col = 1; col <= 8; col++) // Pawns
-    {
-        Piece* p = new Pawn(pawnRow, col, color, this);
-        pieceSet->push_back(p);
-        m_piecePositions[pawnRow - 1][col - 1] = p;
-    }
-    
+    addPiece(backRow, 5, color, KING_ID + color); // The king goes first so it always sits in slot 0
+
     for (int col = 1; col <= 8; col++) // Other Pieces
     {
-        Piece* p;
         switch (col)
         {
             case 1:
             case 8:
-                p = new Rook(backRow, col, color, this);
+                addPiece(backRow, col, color, ROOK_ID + color);
                 break;
             case 2:
             case 7:
-                p = new Knight(backRow, col, color, this);
+                addPiece(backRow, col, color, KNIGHT_ID + color);
                 break;
             case 3:
             case 6:
-                p = new Bishop(backRow, col, color, this);
+                addPiece(backRow, col, color, BISHOP_ID + color);
                 break;
             case 4:
-                p = new Queen(backRow, col, color, this);
-                break;
-            case 5:
-                *kingPointer = new King(backRow, col, color, this);
-                p = *kingPointer;
+                addPiece(backRow, col, color, QUEEN_ID + color);
                 break;
         }
-        
-        pieceSet->push_back(p);
-        m_piecePositions[backRow - 1][col - 1] = p;
+    }
+
+    for (int col = 1; col <= 8; col++) // Pawns
+    {
+        addPiece(pawnRow, col, color, PAWN_ID + color);
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// attemptMove
+// Piece list maintenance
 ////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::attemptMove(Piece* piece, int proposedR, int proposedC)
+void Board::addPiece(int row, int col, int color, int pieceID)
+{
+    int slot = m_numPieces[color]++;
+    m_pieces[color][slot] = Piece(row, col, color, pieceID);
+    m_pieceIndex[row - 1][col - 1] = color * MAX_PIECES + slot;
+    
+    int sq = makeSquare(row, col);
+    Bitboard bb = squareBB(sq);
+    m_byColor[color] |= bb;
+    m_byType[pieceID / 2] |= bb;
+    m_materialKey ^= ZOBRIST_PIECE[pieceID][m_pieceCount[pieceID]++];
+    m_psqMg += PSQ_MG[pieceID][sq];
+    m_psqEg += PSQ_EG[pieceID][sq];
+    m_phase += PHASE_WEIGHT[pieceID / 2];
+}
+
+void Board::removePiece(int row, int col)
 {
-    if (piece->movePossible(proposedR, proposedC))
+    int index = m_pieceIndex[row - 1][col - 1];
+    int color = index / MAX_PIECES;
+    int slot = index % MAX_PIECES;
+    int last = --m_numPieces[color];
+    
+    int sq = makeSquare(row, col);
+    int pieceID = m_pieces[color][slot].pieceID();
+    Bitboard bb = squareBB(sq);
+    m_byColor[color] ^= bb;
+    m_byType[pieceID / 2] ^= bb;
+    m_materialKey ^= ZOBRIST_PIECE[pieceID][--m_pieceCount[pieceID]];
+    m_psqMg -= PSQ_MG[pieceID][sq];
+    m_psqEg -= PSQ_EG[pieceID][sq];
+    m_phase -= PHASE_WEIGHT[pieceID / 2];
+
+    // Fill the hole with the last piece of the same color so the list stays compact
+    if (slot != last)
     {
-        // Special moves (Castle, En Passant)
-        if (piece->pieceID() == KING_ID + piece->color() && piece->row() == proposedR && abs(piece->col() - proposedC) == 2) // Moving two spaces and movePossible == true imples the King is castling
-        {
-            return castle(piece, proposedR, proposedC);
-        }
-        if (piece->pieceID() == PAWN_ID + piece->color() && piece->col() != proposedC && pieceAtPos(proposedR, proposedC) == nullptr) // Moving diagonally to an unoccupied space implies En Passant
-        {
-            return enPassant(piece, proposedR, proposedC);
-        }
-        
-        // Update board, mark a piece as CAPTURED if necessary, increment the piece's m_numMoves variable
-        m_piecePositions[piece->row() - 1][piece->col() - 1] = nullptr;
-        if (pieceAtPos(proposedR, proposedC) != nullptr)
-        {
-            pieceAtPos(proposedR, proposedC)->setAliveStatus(false);
-        }
-        piece->updatePos(proposedR, proposedC);
-        m_piecePositions[proposedR - 1][proposedC - 1] = piece;
-        piece->incrementMoves();
-        
-        // If the piece is a pawn: check for a pawn promotion, update the pawn's m_prevMoveNum variable
-        if (piece->pieceID() == PAWN_ID + piece->color())
+        Piece& moved = m_pieces[color][last];
+        m_pieces[color][slot] = moved;
+        m_pieceIndex[moved.row() - 1][moved.col() - 1] = index;
+    }
+    m_pieceIndex[row - 1][col - 1] = -1;
+}
+
+void Board::movePiece(int fromR, int fromC, int toR, int toC)
+{
+    int index = m_pieceIndex[fromR - 1][fromC - 1];
+    m_pieceIndex[fromR - 1][fromC - 1] = -1;
+    m_pieceIndex[toR - 1][toC - 1] = index;
+    Piece& piece = m_pieces[index / MAX_PIECES][index % MAX_PIECES];
+    piece.updatePos(toR, toC);
+    
+    int from = makeSquare(fromR, fromC);
+    int to = makeSquare(toR, toC);
+    Bitboard fromTo = squareBB(from) | squareBB(to);
+    m_byColor[piece.color()] ^= fromTo;
+    m_byType[piece.pieceID() / 2] ^= fromTo;
+    m_psqMg += PSQ_MG[piece.pieceID()][to] - PSQ_MG[piece.pieceID()][from];
+    m_psqEg += PSQ_EG[piece.pieceID()][to] - PSQ_EG[piece.pieceID()][from];
+}
+
+void Board::changePieceID(int sq, int pieceID)
+{
+    Piece* piece = pieceAtPos(squareRow(sq), squareCol(sq));
+    m_byType[piece->pieceID() / 2] ^= squareBB(sq);
+    m_byType[pieceID / 2] |= squareBB(sq);
+    m_materialKey ^= ZOBRIST_PIECE[piece->pieceID()][--m_pieceCount[piece->pieceID()]];
+    m_materialKey ^= ZOBRIST_PIECE[pieceID][m_pieceCount[pieceID]++];
+    m_psqMg += PSQ_MG[pieceID][sq] - PSQ_MG[piece->pieceID()][sq];
+    m_psqEg += PSQ_EG[pieceID][sq] - PSQ_EG[piece->pieceID()][sq];
+    m_phase += PHASE_WEIGHT[pieceID / 2] - PHASE_WEIGHT[piece->pieceID() / 2];
+    piece->setPieceID(pieceID); // The slot is reused, so promotion is O(1)
+}
+
+Key Board::computeKey() const
+{
+    Key key = ZOBRIST_CASTLING[castlingRights()];
+    for (int color = WHITE; color <= BLACK; color++)
+    {
+        for (int i = 0; i < m_numPieces[color]; i++)
         {
-            if(piece->row() == (piece->color() ? 1 : 8))
-            {
-                Eng().ppMenu(true);
-            }
-            static_cast<Pawn*>(piece)->setPrevMoveNum(totalMoves());
+            const Piece& piece = m_pieces[color][i];
+            key ^= ZOBRIST_PIECE[piece.pieceID()][makeSquare(piece.row(), piece.col())];
         }
-        
-        // Increment the board's m_totalMoves variable
-        m_totalMoves++;
-        return true;
     }
-    return false;
+    if (epSquare() != NO_SQUARE)
+    {
+        key ^= ZOBRIST_EP_FILE[squareCol(epSquare()) - 1];
+    }
+    if (sideToMove() == BLACK)
+    {
+        key ^= ZOBRIST_SIDE;
+    }
+    return key;
 }
 
-bool Board::castle(Piece* king, int proposedR, int proposedC)
+Key Board::computePawnKey() const
 {
-    // Find the direction the king is moving in (neg or pos), find the appropriate rook (based on dir)
-    int dir = (proposedC - king->col()) / 2;
-    int rookC = (dir == WEST ? 1 : 8);
-    Piece* rook = pieceAtPos(proposedR, rookC);
-    
-    // Update the king's position on the board, update the king's internal position
-    m_piecePositions[king->row() - 1][king->col() - 1] = nullptr;
-    king->updatePos(king->row(), proposedC);
-    m_piecePositions[proposedR - 1][proposedC - 1] = king;
-        
-    // Update the rook's position on the board, update the rook's internal position
-    m_piecePositions[rook->row() - 1][rookC - 1] = nullptr;
-    rook->updatePos(rook->row(), proposedC - dir);
-    m_piecePositions[proposedR - 1][(proposedC - dir) - 1] = rook;
-        
-    // Increment m_numMoves variable for both the king and the rook, update the board's m_totalMoves
-    king->incrementMoves();
-    rook->incrementMoves();
-    m_totalMoves++;
-    return true;
+    Key key = 0;
+    for (int pieceID = W_PAWN_ID; pieceID <= B_PAWN_ID; pieceID++)
+    {
+        Bitboard pawns = piecesBB(pieceID);
+        while (pawns)
+        {
+            key ^= ZOBRIST_PIECE[pieceID][popLsb(pawns)];
+        }
+    }
+    return key;
 }
 
-bool Board::enPassant(Piece* pawn, int proposedR, int proposedC)
+////////////////////////////////////////////////////////////////////////////////////////////////
+// attemptMove
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool Board::attemptMove(Piece* piece, int proposedR, int proposedC)
 {
-    // Remove the captured pawn to DEAD, remove it from the board
-    int takenR = pawn->row();
-    int takenC = proposedC;
-    pieceAtPos(takenR, takenC)->setAliveStatus(false);
-    m_piecePositions[takenR - 1][takenC - 1] = nullptr;
+    if (!movePossible(piece, proposedR, proposedC))
+    {
+        return false;
+    }
     
-    // Update the pawn's position on the board, update the pawn's internal position
-    m_piecePositions[pawn->row() - 1][pawn->col() - 1] = nullptr;
-    pawn->updatePos(proposedR, proposedC);
-    m_piecePositions[proposedR - 1][proposedC - 1] = pawn;
+    int from = makeSquare(piece->row(), piece->col());
+    int to = makeSquare(proposedR, proposedC);
+    bool pawn = piece->pieceID() == PAWN_ID + piece->color();
     
-    // Increment the pawn's m_numMoves variable, set the pawn's m_prevMoveNum variable, increment the board's m_totalMoves variable
-    pawn->incrementMoves();
-    static_cast<Pawn*>(pawn)->setPrevMoveNum(totalMoves());
-    m_totalMoves++;
+    // Special moves (Castle, En Passant)
+    int type = MOVE_NORMAL;
+    if (piece->pieceID() == KING_ID + piece->color() && abs(piece->col() - proposedC) == 2) // Moving two spaces and movePossible == true imples the King is castling
+    {
+        type = MOVE_CASTLING;
+    }
+    else if (pawn && piece->col() != proposedC && pieceAtPos(proposedR, proposedC) == nullptr) // Moving diagonally to an unoccupied space implies En Passant
+    {
+        type = MOVE_EN_PASSANT;
+    }
+    doMove(makeMove(from, to, type));
+    
+    // A pawn reaching the back rank stays a pawn until the player picks its promotion. A pawn can only ever reach its own promotion rank.
+    if (pawn && (squareBB(to) & (RANK_1_BB | RANK_8_BB)))
+    {
+        m_promotionPending = true;
+    }
     return true;
 }
 
@@ -183,171 +410,590 @@ bool Board::enPassant(Piece* pawn, int proposedR, int proposedC)
 ////////////////////////////////////////////////////////////////////////////////////////////////
 void Board::promotePawn(Piece* pawn, int promotionID)
 {
-    int promotionR = pawn->row();
-    int promotionC = pawn->col();
-    int color = pawn->color();
-    
-    Piece* promotedPiece;
     switch(promotionID)
     {
         case 2:
         case 3:
-            promotedPiece = new Queen(promotionR, promotionC, color, this);
-            break;
         case 4:
         case 5:
-            promotedPiece = new Rook(promotionR, promotionC, color, this);
-            break;
         case 6:
         case 7:
-            promotedPiece = new Bishop(promotionR, promotionC, color, this);
-            break;
         case 8:
         case 9:
-            promotedPiece = new Knight(promotionR, promotionC, color, this);
+        {
+            // Replay the pawn's move as a promotion so the history and key record the chosen piece
+            Move m = lastMove();
+            undoMove();
+            doMove(makePromotion(moveFrom(m), moveTo(m), promotionID - pawn->color()));
             break;
+        }
         default:
             exit(999);
     }
-    
-    pawn->setAliveStatus(false);
-    m_piecePositions[promotionR - 1][promotionC - 1] = promotedPiece;
-    (color ? m_black : m_white).push_back(promotedPiece);
+    m_promotionPending = false;
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// squareInCheck
+// doMove/undoMove
 ////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::squareInCheck(int row, int col, int attackingColor)
+void Board::doMove(Move m)
 {
-    for (int r = 1; r <= 8; r++)
+    // The history is a ring, so the oldest position is overwritten once it fills. Repetitions never
+    // reach back past the last irreversible move, and neither a game nor a search undoes that far.
+    const StateInfo& prev = state();
+    m_stateIndex++;
+    StateInfo& st = state();
+    st = prev;
+    
+    int us = sideToMove();
+    int from = moveFrom(m);
+    int to = moveTo(m);
+    int pieceID = pieceIDAt(from);
+    Key key = prev.key ^ ZOBRIST_SIDE;
+    
+    st.move = m;
+    st.capturedID = -1;
+    st.rule50++;
+    if (prev.epSquare != NO_SQUARE)
     {
-        for (int c = 1; c <= 8; c++)
+        key ^= ZOBRIST_EP_FILE[squareCol(prev.epSquare) - 1];
+        st.epSquare = NO_SQUARE;
+    }
+    
+    if (moveType(m) == MOVE_CASTLING)
+    {
+        bool kingSide = to > from;
+        int rookFrom = kingSide ? from + 3 : from - 4;
+        int rookTo = kingSide ? from + 1 : from - 1;
+        int rookID = ROOK_ID + us;
+        movePiece(squareRow(from), squareCol(from), squareRow(to), squareCol(to));
+        movePiece(squareRow(rookFrom), squareCol(rookFrom), squareRow(rookTo), squareCol(rookTo));
+        key ^= ZOBRIST_PIECE[pieceID][from] ^ ZOBRIST_PIECE[pieceID][to] ^ ZOBRIST_PIECE[rookID][rookFrom] ^ ZOBRIST_PIECE[rookID][rookTo];
+    }
+    else
+    {
+        int capturedSq = moveType(m) == MOVE_EN_PASSANT ? makeSquare(squareRow(from), squareCol(to)) : to;
+        int capturedID = pieceIDAt(capturedSq);
+        if (capturedID >= 0)
         {
-            Piece* pieceAtPosition = pieceAtPos(r, c);
-            // Intentionally left out kingSafe and opted for 3/4 of the conditions in movePossible()
-            if (pieceAtPosition != nullptr &&
-                pieceAtPosition->color() == attackingColor &&
-                pieceAtPosition->mpAdherent(row, col) &&
-                pieceAtPosition->notBlocked(row, col) &&
-                pieceAtPosition->noPieceOverlap(row, col))
+            st.capturedID = capturedID;
+            st.rule50 = 0;
+            key ^= ZOBRIST_PIECE[capturedID][capturedSq];
+            if (capturedID == PAWN_ID + (us ^ 1))
             {
-                return true;
+                st.pawnKey ^= ZOBRIST_PIECE[capturedID][capturedSq];
+            }
+            removePiece(squareRow(capturedSq), squareCol(capturedSq));
+        }
+        movePiece(squareRow(from), squareCol(from), squareRow(to), squareCol(to));
+        key ^= ZOBRIST_PIECE[pieceID][from] ^ ZOBRIST_PIECE[pieceID][to];
+        
+        if (pieceID == PAWN_ID + us)
+        {
+            st.rule50 = 0;
+            st.pawnKey ^= ZOBRIST_PIECE[pieceID][from] ^ ZOBRIST_PIECE[pieceID][to];
+            // Only record the en passant square if an enemy pawn could use it, so transpositions hash the same
+            if ((to ^ from) == 16 && (PAWN_ATTACKS[us][(from + to) / 2] & piecesBB(B_PAWN_ID - us)))
+            {
+                st.epSquare = (from + to) / 2;
+                key ^= ZOBRIST_EP_FILE[squareCol(st.epSquare) - 1];
+            }
+            if (moveType(m) == MOVE_PROMOTION)
+            {
+                int promotedID = promotionType(m) + us;
+                changePieceID(to, promotedID);
+                key ^= ZOBRIST_PIECE[pieceID][to] ^ ZOBRIST_PIECE[promotedID][to];
+                st.pawnKey ^= ZOBRIST_PIECE[pieceID][to];
             }
         }
     }
-    return false;
+    
+    // Moving the king or a rook, or capturing a rook, gives up the matching castling rights
+    st.castlingRights &= castlingMask(from) & castlingMask(to);
+    key ^= ZOBRIST_CASTLING[prev.castlingRights] ^ ZOBRIST_CASTLING[st.castlingRights];
+    
+    st.key = key;
+    m_totalMoves++;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////
-// kingSafe
-////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::kingSafe(Piece* pieceToMove, int proposedR, int proposedC)
+void Board::undoMove()
 {
-    bool safe;
-    int initR = pieceToMove->row();
-    int initC = pieceToMove->col();
-    
-    m_piecePositions[initR - 1][initC - 1] = nullptr;
-    Piece* pieceAtPropPos = m_piecePositions[proposedR - 1][proposedC - 1];
-    m_piecePositions[proposedR - 1][proposedC - 1] = pieceToMove;
+    const StateInfo& st = state();
+    Move m = st.move;
+    int from = moveFrom(m);
+    int to = moveTo(m);
     
-    int kingR = getKing(pieceToMove->color())->row();
-    int kingC = getKing(pieceToMove->color())->col();
-
-    if (pieceToMove->pieceID() == KING_ID + pieceToMove->color()) // If pieceToMove is a king, return true if king isn't moving into check
+    m_totalMoves--;
+    if (moveType(m) == MOVE_CASTLING)
     {
-        kingR = proposedR;
-        kingC = proposedC;
+        bool kingSide = to > from;
+        int rookFrom = kingSide ? from + 3 : from - 4;
+        int rookTo = kingSide ? from + 1 : from - 1;
+        movePiece(squareRow(to), squareCol(to), squareRow(from), squareCol(from));
+        movePiece(squareRow(rookTo), squareCol(rookTo), squareRow(rookFrom), squareCol(rookFrom));
     }
-    
-    safe = !squareInCheck(kingR, kingC, (pieceToMove->color() ? WHITE : BLACK));
-    
-    m_piecePositions[initR - 1][initC - 1] = pieceToMove;
-    m_piecePositions[proposedR - 1][proposedC - 1] = pieceAtPropPos;
-    return safe;
+    else
+    {
+        if (moveType(m) == MOVE_PROMOTION)
+        {
+            changePieceID(to, PAWN_ID + sideToMove());
+        }
+        movePiece(squareRow(to), squareCol(to), squareRow(from), squareCol(from));
+        if (st.capturedID >= 0)
+        {
+            int capturedSq = moveType(m) == MOVE_EN_PASSANT ? makeSquare(squareRow(from), squareCol(to)) : to;
+            addPiece(squareRow(capturedSq), squareCol(capturedSq), st.capturedID & 1, st.capturedID);
+        }
+    }
+    m_stateIndex--;
 }
 
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// kingCheckmated
+// MOVEMENT RULES
 ////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::kingCheckmated(int color)
+// Each piece type's rules are specializations of mpAdherent<PieceType> and notBlocked<PieceType>.
+// Callers that switch on pieceID() once get the rule inlined instead of an indirect call.
+template<>
+inline bool Board::mpAdherent<KING_ID>(const Piece* piece, int proposedR, int proposedC)
 {
-    King* king = getKing(color);
-    if (!squareInCheck(king->row(), king->col(), (color ? WHITE : BLACK)))
+    if (piece->row() == proposedR && abs(proposedC - piece->col()) == 2 && canCastle(piece, proposedR, proposedC)) // Castle Movement Pattern
     {
-        return false;
+        return true;
     }
-    for (int r = 1; r <= 8; r++)
+    return abs(proposedR - piece->row()) <= 1 && abs(proposedC - piece->col()) <= 1;
+}
+
+template<>
+inline bool Board::mpAdherent<QUEEN_ID>(const Piece* piece, int proposedR, int proposedC)
+{
+    return piece->row() == proposedR || piece->col() == proposedC || abs(proposedR - piece->row()) == abs(proposedC - piece->col());
+}
+
+template<>
+inline bool Board::mpAdherent<ROOK_ID>(const Piece* piece, int proposedR, int proposedC)
+{
+    return piece->row() == proposedR || piece->col() == proposedC;
+}
+
+template<>
+inline bool Board::mpAdherent<BISHOP_ID>(const Piece* piece, int proposedR, int proposedC)
+{
+    return abs(proposedR - piece->row()) == abs(proposedC - piece->col());
+}
+
+template<>
+inline bool Board::mpAdherent<KNIGHT_ID>(const Piece* piece, int proposedR, int proposedC)
+{
+    int dr = abs(piece->row() - proposedR);
+    int dc = abs(piece->col() - proposedC);
+    return (dr == 2 && dc == 1) || (dc == 2 && dr == 1);
+}
+
+template<int Us>
+inline bool Board::pawnMpAdherent(const Piece* pawn, int proposedR, int proposedC)
+{
+    const int dir = Side<Us>::RowDir;
+    int row = pawn->row();
+    int col = pawn->col();
+    
+    if (proposedC == col && (proposedR == row + dir || (row == Side<Us>::PawnRow && proposedR == row + 2 * dir))) // Moving up 1 or 2 squares
     {
-        for (int c = 1; c <= 8; c++)
+        return true;
+    }
+    else if (proposedR == row + dir && abs(proposedC - col) == 1 && (m_byColor[Side<Us>::Them] & squareBB(makeSquare(proposedR, proposedC)))) // Capturing diagonally
+    {
+        return true;
+    }
+    return canEnPassant<Us>(pawn, proposedR, proposedC); // En Passant
+}
+
+template<>
+inline bool Board::mpAdherent<PAWN_ID>(const Piece* piece, int proposedR, int proposedC)
+{
+    return piece->color() ? pawnMpAdherent<BLACK>(piece, proposedR, proposedC) : pawnMpAdherent<WHITE>(piece, proposedR, proposedC);
+}
+
+// Sliding pieces (and the king, whose castling path is checked the same way) share the ray walk
+template<int PieceType>
+inline bool Board::notBlocked(const Piece* piece, int proposedR, int proposedC)
+{
+    int row = piece->row();
+    int col = piece->col();
+    
+    if (row == proposedR)     // Horizontal movement
+    {
+        for (int c = min(col, proposedC) + 1; c < max(col, proposedC); c++)
         {
-            for (int i = 0; i < pieces(color).size(); i++)
-                
-            if (pieces(color)[i]->alive() && pieces(color)[i]->movePossible(r, c))
+            if (m_pieceIndex[proposedR - 1][c - 1] >= 0)
             {
                 return false;
             }
         }
     }
-    if (color == BLACK)
+    else if (col == proposedC)    // Vertical movement
     {
-        cout << "WHITE WINS" << endl;
+        for (int r = min(row, proposedR) + 1; r < max(row, proposedR); r++)
+        {
+            if (m_pieceIndex[r - 1][proposedC - 1] >= 0)
+            {
+                return false;
+            }
+        }
     }
-    else
+    else if (abs(proposedR - row) == abs(proposedC - col))  // Diagonal movement
     {
-        cout << "BLACK WINS" << endl;
+        int rDir = (proposedR - row > 0) ? NORTH : SOUTH;
+        int cDir = (proposedC - col > 0) ? EAST : WEST;
+       
+        int r = row + rDir;
+        int c = col + cDir;
+        
+        while (r != proposedR || c != proposedC)
+        {
+            if (m_pieceIndex[r - 1][c - 1] >= 0)
+            {
+                return false;
+            }
+            r += rDir;
+            c += cDir;
+        }
     }
     return true;
 }
 
+template<>
+inline bool Board::notBlocked<KNIGHT_ID>(const Piece*, int, int)
+{
+    return true;
+}
+
+template<>
+inline bool Board::notBlocked<PAWN_ID>(const Piece* piece, int proposedR, int proposedC) // Pawn can also be blocked by pieces of the opposite color
+{
+    for (int r = min(piece->row(), proposedR) + 1; r < max(piece->row(), proposedR); r++) // Return false if any pieces are in the way
+    {
+        if (m_pieceIndex[r - 1][proposedC - 1] >= 0)
+        {
+            return false;
+        }
+    }
+    // If Pawn is moving straight, return false if (proposedR, proposedC) is occupied by a piece of the opposite color
+    return !(proposedC == piece->col() && m_pieceIndex[proposedR - 1][proposedC - 1] >= 0);
+}
+
+bool Board::mpAdherent(const Piece* piece, int proposedR, int proposedC)
+{
+    switch (piece->pieceID() - piece->color())
+    {
+        case KING_ID:   return mpAdherent<KING_ID>(piece, proposedR, proposedC);
+        case QUEEN_ID:  return mpAdherent<QUEEN_ID>(piece, proposedR, proposedC);
+        case ROOK_ID:   return mpAdherent<ROOK_ID>(piece, proposedR, proposedC);
+        case BISHOP_ID: return mpAdherent<BISHOP_ID>(piece, proposedR, proposedC);
+        case KNIGHT_ID: return mpAdherent<KNIGHT_ID>(piece, proposedR, proposedC);
+        case PAWN_ID:   return mpAdherent<PAWN_ID>(piece, proposedR, proposedC);
+    }
+    return false;
+}
+
+bool Board::notBlocked(const Piece* piece, int proposedR, int proposedC)
+{
+    switch (piece->pieceID() - piece->color())
+    {
+        case KNIGHT_ID: return notBlocked<KNIGHT_ID>(piece, proposedR, proposedC);
+        case PAWN_ID:   return notBlocked<PAWN_ID>(piece, proposedR, proposedC);
+        default:        return notBlocked<QUEEN_ID>(piece, proposedR, proposedC);
+    }
+}
+
+bool Board::noPieceOverlap(const Piece* piece, int proposedR, int proposedC)
+{
+    int index = m_pieceIndex[proposedR - 1][proposedC - 1];
+    return index < 0 || index / MAX_PIECES != piece->color();
+}
+
+bool Board::movePossible(Piece* piece, int proposedR, int proposedC)
+{
+    bool adheres;
+    switch (piece->pieceID() - piece->color())
+    {
+        case KING_ID:   adheres = mpAdherent<KING_ID>(piece, proposedR, proposedC) && notBlocked<KING_ID>(piece, proposedR, proposedC); break;
+        case QUEEN_ID:  adheres = mpAdherent<QUEEN_ID>(piece, proposedR, proposedC) && notBlocked<QUEEN_ID>(piece, proposedR, proposedC); break;
+        case ROOK_ID:   adheres = mpAdherent<ROOK_ID>(piece, proposedR, proposedC) && notBlocked<ROOK_ID>(piece, proposedR, proposedC); break;
+        case BISHOP_ID: adheres = mpAdherent<BISHOP_ID>(piece, proposedR, proposedC) && notBlocked<BISHOP_ID>(piece, proposedR, proposedC); break;
+        case KNIGHT_ID: adheres = mpAdherent<KNIGHT_ID>(piece, proposedR, proposedC); break;
+        case PAWN_ID:   adheres = mpAdherent<PAWN_ID>(piece, proposedR, proposedC) && notBlocked<PAWN_ID>(piece, proposedR, proposedC); break;
+        default:        adheres = false;
+    }
+    return adheres && noPieceOverlap(piece, proposedR, proposedC) && kingSafe(piece, proposedR, proposedC);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// squareInCheck
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool Board::squareInCheck(int row, int col, int attackingColor)
+{
+    int sq = makeSquare(row, col);
+    return attackingColor == WHITE ? squareAttacked<WHITE>(sq, occupied()) : squareAttacked<BLACK>(sq, occupied());
+}
+
+Bitboard Board::attackersTo(int sq, Bitboard occupied) const
+{
+    return (PAWN_ATTACKS[BLACK][sq] & piecesBB(W_PAWN_ID))
+         | (PAWN_ATTACKS[WHITE][sq] & piecesBB(B_PAWN_ID))
+         | (KNIGHT_ATTACKS[sq] & m_byType[KNIGHT_ID / 2])
+         | (KING_ATTACKS[sq] & m_byType[KING_ID / 2])
+         | (bishopAttacks(sq, occupied) & (m_byType[BISHOP_ID / 2] | m_byType[QUEEN_ID / 2]))
+         | (rookAttacks(sq, occupied) & (m_byType[ROOK_ID / 2] | m_byType[QUEEN_ID / 2]));
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// kingStalemated()
+// see
 ////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::kingStalemated(int color)
+// The swap algorithm, without a gain list: swap holds what the side to move in the exchange
+// stands to lose if its capture is answered, and res flips with every capture to say whose
+// turn it is. Sliders uncovered behind each capturer join in as it leaves the square. Pins
+// are ignored, so a pinned piece may take part.
+bool Board::see(Move m, int threshold) const
 {
-    King* king = getKing(color);
-    if (squareInCheck(king->row(), king->col(), (color ? WHITE : BLACK)))
+    if (moveType(m) == MOVE_CASTLING)
+    {
+        return 0 >= threshold;
+    }
+
+    int from = moveFrom(m);
+    int to = moveTo(m);
+    int us = sideToMove();
+    Bitboard occupied = this->occupied() ^ squareBB(from);
+    int gain = 0;
+    int atRisk = PIECE_VALUE[pieceIDAt(from) / 2]; // The piece left standing on to
+    if (moveType(m) == MOVE_EN_PASSANT)
+    {
+        occupied ^= squareBB(makeSquare(squareRow(from), squareCol(to)));
+        gain = PIECE_VALUE[PAWN_ID / 2];
+    }
+    else if (pieceIDAt(to) >= 0)
+    {
+        gain = PIECE_VALUE[pieceIDAt(to) / 2];
+    }
+    if (moveType(m) == MOVE_PROMOTION)
+    {
+        gain += PIECE_VALUE[promotionType(m) / 2] - PIECE_VALUE[PAWN_ID / 2];
+        atRisk = PIECE_VALUE[promotionType(m) / 2];
+    }
+
+    int swap = gain - threshold;
+    if (swap < 0) // Even if the piece isn't taken back, it isn't enough
     {
         return false;
     }
-    for (int r = 1; r <= 8; r++)
+    swap = atRisk - swap;
+    if (swap <= 0) // Even losing the piece, it is enough
+    {
+        return true;
+    }
+
+    Bitboard diagonal = m_byType[BISHOP_ID / 2] | m_byType[QUEEN_ID / 2];
+    Bitboard straight = m_byType[ROOK_ID / 2] | m_byType[QUEEN_ID / 2];
+    Bitboard attackers = attackersTo(to, occupied);
+    int stm = us;
+    int res = 1;
+    while (true)
     {
-        for (int c = 1; c <= 8; c++)
+        stm ^= 1;
+        attackers &= occupied;
+        Bitboard stmAttackers = attackers & m_byColor[stm];
+        if (!stmAttackers)
+        {
+            break;
+        }
+        res ^= 1;
+
+        // Take with the least valuable attacker, then look through it for the sliders behind
+        Bitboard bb;
+        if ((bb = stmAttackers & m_byType[PAWN_ID / 2]))
         {
-            for (int i = 0; i < pieces(color).size(); i++)
-                
-            if (pieces(color)[i]->alive() && pieces(color)[i]->movePossible(r, c))
+            if ((swap = PIECE_VALUE[PAWN_ID / 2] - swap) < res)
             {
-                return false;
+                break;
+            }
+            occupied ^= squareBB(lsb(bb));
+            attackers |= bishopAttacks(to, occupied) & diagonal;
+        }
+        else if ((bb = stmAttackers & m_byType[KNIGHT_ID / 2]))
+        {
+            if ((swap = PIECE_VALUE[KNIGHT_ID / 2] - swap) < res)
+            {
+                break;
             }
+            occupied ^= squareBB(lsb(bb));
+        }
+        else if ((bb = stmAttackers & m_byType[BISHOP_ID / 2]))
+        {
+            if ((swap = PIECE_VALUE[BISHOP_ID / 2] - swap) < res)
+            {
+                break;
+            }
+            occupied ^= squareBB(lsb(bb));
+            attackers |= bishopAttacks(to, occupied) & diagonal;
+        }
+        else if ((bb = stmAttackers & m_byType[ROOK_ID / 2]))
+        {
+            if ((swap = PIECE_VALUE[ROOK_ID / 2] - swap) < res)
+            {
+                break;
+            }
+            occupied ^= squareBB(lsb(bb));
+            attackers |= rookAttacks(to, occupied) & straight;
+        }
+        else if ((bb = stmAttackers & m_byType[QUEEN_ID / 2]))
+        {
+            if ((swap = PIECE_VALUE[QUEEN_ID / 2] - swap) < res)
+            {
+                break;
+            }
+            occupied ^= squareBB(lsb(bb));
+            attackers |= (bishopAttacks(to, occupied) & diagonal) | (rookAttacks(to, occupied) & straight);
+        }
+        else // The king can only take if nothing is left to take it back
+        {
+            return (attackers & ~m_byColor[stm]) ? res ^ 1 : res;
         }
     }
-    cout << "IT'S A DRAW" << endl;
-    return true;
+    return bool(res);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// kingSafe
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool Board::kingSafe(Piece* pieceToMove, int proposedR, int proposedC)
+{
+    int from = makeSquare(pieceToMove->row(), pieceToMove->col());
+    int to = makeSquare(proposedR, proposedC);
+    int capturedSq = m_pieceIndex[proposedR - 1][proposedC - 1] >= 0 ? to : NO_SQUARE;
+    
+    // A pawn moving diagonally onto the en passant square captures the pawn beside it
+    if (pieceToMove->pieceID() == PAWN_ID + pieceToMove->color() && to == epSquare() && proposedC != pieceToMove->col())
+    {
+        capturedSq = makeSquare(pieceToMove->row(), proposedC);
+    }
+    return pieceToMove->color() ? kingSafeAfter<BLACK>(from, to, capturedSq) : kingSafeAfter<WHITE>(from, to, capturedSq);
+}
+
+bool Board::legal(Move m) const
+{
+    int from = moveFrom(m);
+    int to = moveTo(m);
+    int us = m_byColor[WHITE] & squareBB(from) ? WHITE : BLACK;
+    
+    if (moveType(m) == MOVE_CASTLING) // The generator only emits castling when the king's path is safe
+    {
+        return true;
+    }
+    
+    int capturedSq = (occupied() & squareBB(to)) ? to : NO_SQUARE;
+    if (moveType(m) == MOVE_EN_PASSANT)
+    {
+        capturedSq = makeSquare(squareRow(from), squareCol(to));
+    }
+    return us == WHITE ? kingSafeAfter<WHITE>(from, to, capturedSq) : kingSafeAfter<BLACK>(from, to, capturedSq);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// gameStatus
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool Board::inCheck() const
+{
+    int ksq = kingSquare(sideToMove());
+    return sideToMove() == WHITE ? squareAttacked<BLACK>(ksq, occupied()) : squareAttacked<WHITE>(ksq, occupied());
+}
+
+int Board::gameStatus() const
+{
+    if (!hasLegalMove(*this)) // Stops at the first legal move, so an ongoing game costs a single generation pass
+    {
+        return inCheck() ? GAME_CHECKMATE : GAME_STALEMATE;
+    }
+    if (repetition(2))
+    {
+        return GAME_DRAW_REPETITION;
+    }
+    if (fiftyMoveDraw())
+    {
+        return GAME_DRAW_FIFTY_MOVES;
+    }
+    if (insufficientMaterial())
+    {
+        return GAME_DRAW_MATERIAL;
+    }
+    return GAME_ONGOING;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// DRAWS
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool Board::repetition(int times) const
+{
+    // Positions before the last capture or pawn move can't repeat, so the scan stops there. Only
+    // positions with the same side to move are compared, hence the step of two.
+    const StateInfo& st = state();
+    int end = min(min(st.rule50, m_stateIndex), HISTORY_SIZE - 1);
+    int count = 0;
+    for (int i = 4; i <= end; i += 2)
+    {
+        if (m_states[(m_stateIndex - i) & (HISTORY_SIZE - 1)].key == st.key && ++count >= times)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Board::fiftyMoveDraw() const
+{
+    return state().rule50 >= 100;
+}
+
+bool Board::insufficientMaterial() const
+{
+    if (m_byType[PAWN_ID / 2] | m_byType[ROOK_ID / 2] | m_byType[QUEEN_ID / 2])
+    {
+        return false;
+    }
+    int knights = m_pieceCount[W_KNIGHT_ID] + m_pieceCount[B_KNIGHT_ID];
+    int bishops = m_pieceCount[W_BISHOP_ID] + m_pieceCount[B_BISHOP_ID];
+    if (knights + bishops <= 1) // K vs K, KN vs K, KB vs K
+    {
+        return true;
+    }
+    
+    // Any number of bishops that all stand on the same square color can't mate either
+    const Bitboard DARK_SQUARES = 0xAA55AA55AA55AA55ULL;
+    Bitboard bishopBB = m_byType[BISHOP_ID / 2];
+    return knights == 0 && ((bishopBB & DARK_SQUARES) == 0 || (bishopBB & ~DARK_SQUARES) == 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // canCastle
 ////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::canCastle(King* king, int proposedR, int proposedC)
+template<int Us>
+bool Board::canCastle(int proposedC)
 {
-    int dir = (proposedC - king->col()) / 2;
-    int rookC = (dir == WEST ? 1 : 8);
+    const int Them = Side<Us>::Them;
+    bool kingSide = proposedC > 5;
     
-    if (king->numMoves() != 0 ||
-        !king->notBlocked(king->row(), rookC) ||
-        pieceAtPos(king->row(), rookC) == nullptr ||
-        pieceAtPos(king->row(), rookC)->pieceID() != ROOK_ID + king->color() ||
-        pieceAtPos(king->row(), rookC)->numMoves() != 0)
+    if (!(castlingRights() & (kingSide ? Side<Us>::KingSideRights : Side<Us>::QueenSideRights)) ||
+        (occupied() & (kingSide ? Side<Us>::KingSidePath : Side<Us>::QueenSidePath)))
     {
         return false;
     }
     
-    for (int c = king->col(); c != king->col() + 3 * dir; c += dir)
+    // The king may not castle out of, through, or into check
+    int dir = kingSide ? 1 : -1;
+    for (int sq = Side<Us>::KingStart; sq != Side<Us>::KingStart + 3 * dir; sq += dir)
     {
-        if (squareInCheck(king->row(), c, (king->color() ? WHITE : BLACK)))
+        if (squareAttacked<Them>(sq, occupied()))
         {
             return false;
         }
@@ -355,47 +1001,63 @@ bool Board::canCastle(King* king, int proposedR, int proposedC)
     return true;
 }
 
+bool Board::canCastle(const Piece* king, int proposedR, int proposedC)
+{
+    // Castling rights are only kept while the king and rook are on their starting squares
+    if (king->color() == WHITE)
+    {
+        return makeSquare(king->row(), king->col()) == Side<WHITE>::KingStart && proposedR == Side<WHITE>::BackRow && canCastle<WHITE>(proposedC);
+    }
+    return makeSquare(king->row(), king->col()) == Side<BLACK>::KingStart && proposedR == Side<BLACK>::BackRow && canCastle<BLACK>(proposedC);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // canEnPassant
 ////////////////////////////////////////////////////////////////////////////////////////////////
-bool Board::canEnPassant(Pawn* pawn, int proposedR, int proposedC)
+template<int Us>
+bool Board::canEnPassant(const Piece* pawn, int proposedR, int proposedC)
 {
-    if (pawn->numMoves() == 3 &&
-        pawn->row() == (pawn->color() ? 4 : 5) &&
-        proposedR - pawn->row() == (pawn->color() ? SOUTH : NORTH) &&
-        abs(proposedC - pawn->col()) == 1 &&
-        pieceAtPos(pawn->row(), proposedC) != nullptr &&
-        pieceAtPos(pawn->row(), proposedC)->pieceID() == B_PAWN_ID - pawn->color() &&
-        pieceAtPos(pawn->row(), proposedC)->numMoves() == 1 &&
-        static_cast<Pawn*>(pieceAtPos(pawn->row(), proposedC))->prevMoveNum() == totalMoves() - 1)
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    return pawn->row() == Side<Us>::EnPassantRow &&
+           proposedR - pawn->row() == Side<Us>::RowDir &&
+           abs(proposedC - pawn->col()) == 1 &&
+           makeSquare(proposedR, proposedC) == epSquare();
+}
+
+bool Board::canEnPassant(const Piece* pawn, int proposedR, int proposedC)
+{
+    return pawn->color() ? canEnPassant<BLACK>(pawn, proposedR, proposedC) : canEnPassant<WHITE>(pawn, proposedR, proposedC);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // ACCESSORS
 ////////////////////////////////////////////////////////////////////////////////////////////////
-int Board::totalMoves()
+int Board::totalMoves() const
 {
     return m_totalMoves;
 }
 
-std::vector<Piece*>& Board::pieces(int color)
+bool Board::promotionPending()
+{
+    return m_promotionPending;
+}
+
+Piece* Board::pieces(int color)
+{
+    return m_pieces[color];
+}
+
+int Board::numPieces(int color)
 {
-    return (color ? m_black : m_white);
+    return m_numPieces[color];
 }
 
-Piece*& Board::pieceAtPos(int r, int c)
+Piece* Board::pieceAtPos(int r, int c)
 {
-    return m_piecePositions[r - 1][c - 1];
+    int index = m_pieceIndex[r - 1][c - 1];
+    return index < 0 ? nullptr : &m_pieces[0][0] + index; // The two piece lists are contiguous, so the index addresses them directly
 }
 
-King*& Board::getKing(int color)
+Piece* Board::getKing(int color)
 {
-   return (color ? m_blackKing : m_whiteKing);
+   return &m_pieces[color][0];
 }
@@ -9,46 +9,294 @@
 #define BOARD_INCLUDED
 
 #include <iostream>
-#include <vector>
+#include <string>
+#include <type_traits>
 #include "Piece.h"
+#include "Bitboard.h"
+#include "Move.h"
+#include "Zobrist.h"
+#include "globals.h"
+
+// Everything about a position that can't be recovered when a move is undone. Board keeps one per ply.
+struct StateInfo
+{
+    Key key;
+    Key pawnKey;        // Zobrist key of the pawns alone, for the pawn hash table
+    Move move;          // The move that led to this position
+    int capturedID;     // pieceID captured by that move, or -1
+    int castlingRights;
+    int epSquare;
+    int rule50;         // Plies since the last capture or pawn move
+};
 
 class Board
 {
 public:
     Board();
-    ~Board();
-    
+
     void placePieces(int color); // Places pieces in the correct position to start the game.
-    
+    bool setFen(const std::string& fen); // Sets up the position from FEN, dropping the history. Returns false, leaving an empty board, if fen is malformed.
+    bool setPosition(const int pieceAt[64], int sideToMove, int castlingRights, int epSquare, int rule50, int fullMoves); // Same from a pieceID (or -1) per square. Fails if a side doesn't have exactly one king, or has more than MAX_PIECES pieces.
+
     bool attemptMove(Piece* piece, int proposedR, int proposedC); // Attempts to move piece to (proposedR, proposedC), and returns true if it succeeds.
-    bool castle(Piece* king, int proposedR, int proposedC);
-    bool enPassant(Piece* pawn, int propsoedR, int proposedC);
-    void promotePawn(Piece* pawn, int promotionID);
-    
+    void promotePawn(Piece* pawn, int promotionID); // Turns the pawn that just reached the back rank into promotionID.
+
+    // MAKE/UNMAKE
+    void doMove(Move m); // Plays a legal move and pushes its StateInfo.
+    void undoMove(); // Takes back the last move played with doMove. Only the last HISTORY_SIZE - 1 moves can be taken back.
+
+    // MOVEMENT RULES
+    bool mpAdherent(const Piece* piece, int proposedR, int proposedC); // Returns true if (proposedR, proposedC) adheres to the piece's movement pattern.
+    bool notBlocked(const Piece* piece, int proposedR, int proposedC); // Returns true if the squares between the piece and (propsoedR, proposedC) are not occupied.
+    bool noPieceOverlap(const Piece* piece, int proposedR, int proposedC); // Returns true if there is not a piece of the same color at (proposedR, proposedC).
+    bool movePossible(Piece* piece, int proposedR, int proposedC); // Returns true if the move to (proposedR, proposedC) is mpAdherent, notBlocked, noPieceOverlap, and kingSafe.
+
     bool squareInCheck(int row, int col, int attackingColor); // Returns true if this square is in check.
     bool kingSafe(Piece* pieceToMove, int proposedR, int proposedC); // Returns true if the proposed move won't put the king in check.
-    bool kingCheckmated(int color); // Returns true if the king of the specified color has been checkmated.
-    bool kingStalemated(int color); // Returns true if the king of the specified color has been stalemated.
-    bool canCastle(King* king, int proposedR, int proposedC); // Returns true if king can castle.
-    bool canEnPassant(Pawn* pawn, int proposedR, int proposedC); // Returns true if pawn can en passant.
-    
+    bool inCheck() const; // Returns true if the side to move is in check.
+    int gameStatus() const; // Returns one of the GAME_ constants for the side to move.
+
+    // DRAWS (cheap enough to call at every search node)
+    bool repetition(int times) const; // Returns true if the current position already occurred at least this many times since the last irreversible move.
+    bool fiftyMoveDraw() const;
+    bool insufficientMaterial() const; // Returns true if neither side has enough material to mate.
+    bool canCastle(const Piece* king, int proposedR, int proposedC); // Returns true if king can castle.
+    bool canEnPassant(const Piece* pawn, int proposedR, int proposedC); // Returns true if pawn can en passant.
+
+    // BITBOARD ATTACKS
+    template<int Them> bool squareAttacked(int sq, Bitboard occupied) const; // Returns true if a piece of color Them attacks sq, given the occupancy.
+    Bitboard attackersTo(int sq, Bitboard occupied) const; // Returns the pieces of both colors that attack sq, given the occupancy.
+    template<int Us> bool kingSafeAfter(int from, int to, int capturedSq) const; // Returns true if Us's king is not attacked after moving from -> to and removing the piece on capturedSq (NO_SQUARE if none).
+    bool legal(Move m) const; // Returns true if the pseudo-legal move m doesn't leave the mover's king in check.
+    bool isCapture(Move m) const; // Returns true if m takes a piece, en passant included.
+    bool see(Move m, int threshold) const; // Static exchange evaluation: returns true if m gains at least threshold (in PIECE_VALUE units) once both sides have recaptured on its target square, cheapest piece first, for as long as it pays. Plays no moves.
+
     // ACCESSORS
-    int totalMoves();
-    std::vector<Piece*>& pieces(int color); // Returns a reference to m_white or m_black, depending on the specified color.
-    Piece*& pieceAtPos(int r, int c); // Returns a reference to the Piece pointer at [r-1][c-1] in m_piecePositions.
-    King*& getKing(int color); // Returns a reference to m_whiteKing or m_blackKing, depending on the specified color.
+    int totalMoves() const;
+    int sideToMove() const;
+    bool promotionPending(); // Returns true if the last move brought a pawn to the back rank and promotePawn hasn't been called yet.
+    Piece* pieces(int color); // Returns the compact piece list of the specified color; only the first numPieces(color) entries are in play.
+    int numPieces(int color);
+    Piece* pieceAtPos(int r, int c); // Returns the piece at (r, c), or nullptr if the square is empty.
+    Piece* getKing(int color); // The king is always the first entry of its color's piece list.
+    int pieceIDAt(int sq) const; // Returns the pieceID on sq, or -1 if it is empty.
+
+    Bitboard occupied() const;
+    Bitboard colorBB(int color) const;
+    Bitboard piecesBB(int pieceID) const; // Pieces with this exact pieceID (type and color)
+    Bitboard typeBB(int pieceType) const; // Pieces of this type (KING_ID, QUEEN_ID, ...) of both colors
+    int kingSquare(int color) const;
+    int epSquare() const; // The square a pawn just skipped over with a double push, if an enemy pawn could capture there, or NO_SQUARE.
+    int castlingRights() const;
+    int rule50() const;
+    Key key() const;
+    Key pawnKey() const;
+    Key materialKey() const; // Depends only on how many of each piece are left, for the material table
+    Move lastMove() const;
+    int capturedPiece() const; // pieceID the last move captured, or -1
+    int pieceCount(int pieceID) const;
+    int psqMg() const; // Middlegame material and piece-square sum, from white's point of view
+    int psqEg() const; // Endgame material and piece-square sum, from white's point of view
+    int phase() const; // Sum of PHASE_WEIGHT over the pieces on the board; PHASE_MAX at the start
 
 private:
+    template<int PieceType> bool mpAdherent(const Piece* piece, int proposedR, int proposedC); // Specialized per piece type in Board.cpp.
+    template<int PieceType> bool notBlocked(const Piece* piece, int proposedR, int proposedC);
+    template<int Us> bool pawnMpAdherent(const Piece* pawn, int proposedR, int proposedC);
+    template<int Us> bool canCastle(int proposedC);
+    template<int Us> bool canEnPassant(const Piece* pawn, int proposedR, int proposedC);
+
+    void addPiece(int row, int col, int color, int pieceID);
+    void removePiece(int row, int col); // Swaps the last piece of the same color into the freed slot.
+    void movePiece(int fromR, int fromC, int toR, int toC);
+    void changePieceID(int sq, int pieceID); // Promotes or demotes the piece on sq in place.
+    Key computeKey() const;
+    Key computePawnKey() const;
+    void clear(); // Empties the board and its history
+
+    StateInfo& state();
+    const StateInfo& state() const;
+
     int m_rows = 8;
     int m_cols = 8;
     int m_totalMoves = 0;
-    
-    std::vector<Piece*> m_white;
-    std::vector<Piece*> m_black;
-    King* m_whiteKing;
-    King* m_blackKing;
-    
-    Piece* m_piecePositions[8][8];
+    bool m_promotionPending = false;
+
+    Piece m_pieces[2][MAX_PIECES];
+    int m_numPieces[2];
+    signed char m_pieceIndex[8][8]; // color * MAX_PIECES + slot of the piece on each square, or -1 if empty.
+
+    Bitboard m_byColor[2];
+    Bitboard m_byType[NUM_PIECE_TYPES]; // Indexed by pieceID / 2
+    int m_pieceCount[12];
+    int m_psqMg = 0; // Running PSQ totals, updated by the piece list maintenance functions
+    int m_psqEg = 0;
+    int m_phase = 0;
+    Key m_materialKey = 0; // XOR of ZOBRIST_PIECE[pieceID][i] for i below each pieceID's count
+
+    StateInfo m_states[HISTORY_SIZE]; // Ring of the latest positions; state() describes the current one
+    int m_stateIndex = 0; // Plies since the history was cleared; the ring slot is this modulo HISTORY_SIZE
 };
 
+static_assert(std::is_trivially_copyable<Board>::value, "Board must stay copyable with memcpy");
+static_assert((HISTORY_SIZE & (HISTORY_SIZE - 1)) == 0, "the history ring is indexed with a mask");
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ACCESSORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline int Board::sideToMove() const
+{
+    return m_totalMoves & 1;
+}
+
+inline Bitboard Board::occupied() const
+{
+    return m_byColor[WHITE] | m_byColor[BLACK];
+}
+
+inline Bitboard Board::colorBB(int color) const
+{
+    return m_byColor[color];
+}
+
+inline Bitboard Board::piecesBB(int pieceID) const
+{
+    return m_byType[pieceID / 2] & m_byColor[pieceID & 1];
+}
+
+inline Bitboard Board::typeBB(int pieceType) const
+{
+    return m_byType[pieceType / 2];
+}
+
+inline int Board::kingSquare(int color) const
+{
+    return makeSquare(m_pieces[color][0].row(), m_pieces[color][0].col());
+}
+
+inline int Board::pieceIDAt(int sq) const
+{
+    int index = m_pieceIndex[sq >> 3][sq & 7];
+    return index < 0 ? -1 : (&m_pieces[0][0] + index)->pieceID();
+}
+
+inline bool Board::isCapture(Move m) const
+{
+    return moveType(m) == MOVE_EN_PASSANT || (moveType(m) != MOVE_CASTLING && pieceIDAt(moveTo(m)) >= 0);
+}
+
+inline StateInfo& Board::state()
+{
+    return m_states[m_stateIndex & (HISTORY_SIZE - 1)];
+}
+
+inline const StateInfo& Board::state() const
+{
+    return m_states[m_stateIndex & (HISTORY_SIZE - 1)];
+}
+
+inline int Board::epSquare() const
+{
+    return state().epSquare;
+}
+
+inline int Board::castlingRights() const
+{
+    return state().castlingRights;
+}
+
+inline int Board::rule50() const
+{
+    return state().rule50;
+}
+
+inline Key Board::key() const
+{
+    return state().key;
+}
+
+inline Key Board::pawnKey() const
+{
+    return state().pawnKey;
+}
+
+inline Key Board::materialKey() const
+{
+    return m_materialKey;
+}
+
+inline Move Board::lastMove() const
+{
+    return state().move;
+}
+
+inline int Board::capturedPiece() const
+{
+    return state().capturedID;
+}
+
+inline int Board::pieceCount(int pieceID) const
+{
+    return m_pieceCount[pieceID];
+}
+
+inline int Board::psqMg() const
+{
+    return m_psqMg;
+}
+
+inline int Board::psqEg() const
+{
+    return m_psqEg;
+}
+
+inline int Board::phase() const
+{
+    return m_phase;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ATTACKS
+////////////////////////////////////////////////////////////////////////////////////////////////
+template<int Them>
+inline bool Board::squareAttacked(int sq, Bitboard occupied) const
+{
+    const int Us = Side<Them>::Them;
+    Bitboard them = m_byColor[Them];
+    Bitboard diagonal = (m_byType[BISHOP_ID / 2] | m_byType[QUEEN_ID / 2]) & them;
+    Bitboard straight = (m_byType[ROOK_ID / 2] | m_byType[QUEEN_ID / 2]) & them;
+
+    return (PAWN_ATTACKS[Us][sq] & m_byType[PAWN_ID / 2] & them)
+        || (KNIGHT_ATTACKS[sq] & m_byType[KNIGHT_ID / 2] & them)
+        || (KING_ATTACKS[sq] & m_byType[KING_ID / 2] & them)
+        || (diagonal && (bishopAttacks(sq, occupied) & diagonal))
+        || (straight && (rookAttacks(sq, occupied) & straight));
+}
+
+template<int Us>
+inline bool Board::kingSafeAfter(int from, int to, int capturedSq) const
+{
+    const int Them = Side<Us>::Them;
+    Bitboard captured = capturedSq == NO_SQUARE ? 0 : squareBB(capturedSq);
+    Bitboard occupiedAfter = (occupied() & ~squareBB(from) & ~captured) | squareBB(to);
+    int ksq = kingSquare(Us);
+    if (ksq == from)
+    {
+        ksq = to;
+    }
+
+    // Same as squareAttacked<Them>, but with the captured piece taken off the board
+    Bitboard them = m_byColor[Them] & ~captured;
+    Bitboard diagonal = (m_byType[BISHOP_ID / 2] | m_byType[QUEEN_ID / 2]) & them;
+    Bitboard straight = (m_byType[ROOK_ID / 2] | m_byType[QUEEN_ID / 2]) & them;
+
+    return !((PAWN_ATTACKS[Us][ksq] & m_byType[PAWN_ID / 2] & them)
+          || (KNIGHT_ATTACKS[ksq] & m_byType[KNIGHT_ID / 2] & them)
+          || (KING_ATTACKS[ksq] & m_byType[KING_ID / 2] & them)
+          || (diagonal && (bishopAttacks(ksq, occupiedAfter) & diagonal))
+          || (straight && (rookAttacks(ksq, occupiedAfter) & straight)));
+}
+
 #endif /* BOARD_INCLUDED */
@@ -0,0 +1,273 @@
+//
+//  Endgame.cpp
+//  Chess
+//
+
+#include "Endgame.h"
+#include "Board.h"
+#include "Evaluate.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+static int distance(int a, int b)
+{
+    return max(abs((a >> 3) - (b >> 3)), abs((a & 7) - (b & 7)));
+}
+
+// 0 with the king in the centre, 120 in a corner
+static int pushToEdge(int sq)
+{
+    int rank = sq >> 3;
+    int file = sq & 7;
+    return 20 * (max(3 - rank, rank - 4) + max(3 - file, file - 4));
+}
+
+static int pushClose(int a, int b)
+{
+    return 140 - 20 * distance(a, b);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// KPK bitbase
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Every KPK position with white holding the pawn on files a-d, solved by retrograde iteration.
+// Positions with black holding the pawn, or with the pawn on files e-h, are mirrored onto these.
+const int KPK_SIZE = 2 * 24 * 64 * 64; // Side to move, pawn square, black king, white king
+static uint32_t KPK_BITBASE[KPK_SIZE / 32]; // Bit set if white wins
+
+const unsigned char KPK_INVALID = 0;
+const unsigned char KPK_UNKNOWN = 1;
+const unsigned char KPK_DRAW = 2;
+const unsigned char KPK_WIN = 4;
+
+static int kpkIndex(int sideToMove, int blackKing, int whiteKing, int pawn)
+{
+    return whiteKing | (blackKing << 6) | (sideToMove << 12) | ((pawn & 7) << 13) | ((6 - (pawn >> 3)) << 15);
+}
+
+struct KPKPosition
+{
+    int sideToMove;
+    int whiteKing;
+    int blackKing;
+    int pawn;
+};
+
+static KPKPosition kpkPosition(int index)
+{
+    KPKPosition p;
+    p.whiteKing = index & 63;
+    p.blackKing = (index >> 6) & 63;
+    p.sideToMove = (index >> 12) & 1;
+    p.pawn = ((index >> 13) & 3) + 8 * (6 - ((index >> 15) & 7));
+    return p;
+}
+
+// Results that follow from the position alone, without looking at any moves
+static unsigned char kpkInitial(const KPKPosition& p)
+{
+    int push = p.pawn + 8;
+    if (distance(p.whiteKing, p.blackKing) <= 1 || p.whiteKing == p.pawn || p.blackKing == p.pawn
+        || (p.sideToMove == WHITE && (PAWN_ATTACKS[WHITE][p.pawn] & squareBB(p.blackKing))))
+    {
+        return KPK_INVALID;
+    }
+    // The pawn promotes and the new queen can't be taken
+    if (p.sideToMove == WHITE && (p.pawn >> 3) == 6 && p.whiteKing != push && p.blackKing != push
+        && (distance(p.blackKing, push) > 1 || distance(p.whiteKing, push) == 1))
+    {
+        return KPK_WIN;
+    }
+    // Stalemate, or the black king takes the undefended pawn
+    if (p.sideToMove == BLACK
+        && (!(KING_ATTACKS[p.blackKing] & ~(KING_ATTACKS[p.whiteKing] | PAWN_ATTACKS[WHITE][p.pawn]))
+            || (KING_ATTACKS[p.blackKing] & ~KING_ATTACKS[p.whiteKing] & squareBB(p.pawn))))
+    {
+        return KPK_DRAW;
+    }
+    return KPK_UNKNOWN;
+}
+
+// A position is won for white if some white move reaches a win, or every black move does.
+// Illegal successors are KPK_INVALID, which adds nothing to the OR.
+static unsigned char kpkClassify(const vector<unsigned char>& db, const KPKPosition& p)
+{
+    unsigned char good = p.sideToMove == WHITE ? KPK_WIN : KPK_DRAW;
+    unsigned char bad = p.sideToMove == WHITE ? KPK_DRAW : KPK_WIN;
+    unsigned char r = KPK_INVALID;
+
+    Bitboard moves = KING_ATTACKS[p.sideToMove == WHITE ? p.whiteKing : p.blackKing];
+    while (moves)
+    {
+        int to = popLsb(moves);
+        r |= p.sideToMove == WHITE ? db[kpkIndex(BLACK, p.blackKing, to, p.pawn)] : db[kpkIndex(WHITE, to, p.whiteKing, p.pawn)];
+    }
+    if (p.sideToMove == WHITE)
+    {
+        // Promotions were settled by kpkInitial
+        if ((p.pawn >> 3) < 6)
+        {
+            r |= db[kpkIndex(BLACK, p.blackKing, p.whiteKing, p.pawn + 8)];
+        }
+        if ((p.pawn >> 3) == 1 && p.pawn + 8 != p.whiteKing && p.pawn + 8 != p.blackKing)
+        {
+            r |= db[kpkIndex(BLACK, p.blackKing, p.whiteKing, p.pawn + 16)];
+        }
+    }
+    return (r & good) ? good : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : bad;
+}
+
+static void initKPK()
+{
+    vector<unsigned char> db(KPK_SIZE);
+    for (int i = 0; i < KPK_SIZE; i++)
+    {
+        db[i] = kpkInitial(kpkPosition(i));
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < KPK_SIZE; i++)
+        {
+            if (db[i] == KPK_UNKNOWN)
+            {
+                db[i] = kpkClassify(db, kpkPosition(i));
+                changed = changed || db[i] != KPK_UNKNOWN;
+            }
+        }
+    }
+
+    memset(KPK_BITBASE, 0, sizeof(KPK_BITBASE));
+    for (int i = 0; i < KPK_SIZE; i++)
+    {
+        if (db[i] == KPK_WIN)
+        {
+            KPK_BITBASE[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+bool probeKPK(int strongSide, int strongKing, int strongPawn, int weakKing, int sideToMove)
+{
+    // Flip the board so the pawn is white and on the queen side
+    int flip = (strongSide == WHITE ? 0 : 56) ^ ((strongPawn & 7) >= 4 ? 7 : 0);
+    int index = kpkIndex(sideToMove == strongSide ? WHITE : BLACK, weakKing ^ flip, strongKing ^ flip, strongPawn ^ flip);
+    return KPK_BITBASE[index / 32] & (1u << (index % 32));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Evaluators
+////////////////////////////////////////////////////////////////////////////////////////////////
+// KQK and KRK: drive the lone king to the edge and bring ours next to it
+static int evaluateKXK(const Board& b, int strongSide)
+{
+    int strongKing = b.kingSquare(strongSide);
+    int weakKing = b.kingSquare(strongSide ^ 1);
+    int material = b.pieceCount(QUEEN_ID + strongSide) * PIECE_VALUE[QUEEN_ID / 2] + b.pieceCount(ROOK_ID + strongSide) * PIECE_VALUE[ROOK_ID / 2];
+    return KNOWN_WIN + material + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+}
+
+// KBNK: mate is only possible in a corner the bishop covers, so drive the king there
+static int evaluateKBNK(const Board& b, int strongSide)
+{
+    int strongKing = b.kingSquare(strongSide);
+    int weakKing = b.kingSquare(strongSide ^ 1);
+    int bishop = lsb(b.piecesBB(BISHOP_ID + strongSide));
+    bool darkSquares = ((bishop >> 3) + (bishop & 7)) % 2 == 0; // a1 is dark
+    int corner = darkSquares ? min(distance(weakKing, 0), distance(weakKing, 63)) : min(distance(weakKing, 7), distance(weakKing, 56));
+    return KNOWN_WIN + PIECE_VALUE[BISHOP_ID / 2] + PIECE_VALUE[KNIGHT_ID / 2] + 50 * (7 - corner) + pushClose(strongKing, weakKing);
+}
+
+// KPK: exact from the bitbase. A win is worth more the further the pawn has come.
+static int evaluateKPK(const Board& b, int strongSide)
+{
+    int strongKing = b.kingSquare(strongSide);
+    int weakKing = b.kingSquare(strongSide ^ 1);
+    int pawn = lsb(b.piecesBB(PAWN_ID + strongSide));
+    if (!probeKPK(strongSide, strongKing, pawn, weakKing, b.sideToMove()))
+    {
+        return 0;
+    }
+    int rank = strongSide == WHITE ? pawn >> 3 : 7 - (pawn >> 3);
+    return KNOWN_WIN + PIECE_VALUE[PAWN_ID / 2] + 20 * rank;
+}
+
+// KQKR: a win in general, but a long one, so it isn't scored as a known win
+static int evaluateKQKR(const Board& b, int strongSide)
+{
+    int strongKing = b.kingSquare(strongSide);
+    int weakKing = b.kingSquare(strongSide ^ 1);
+    return PIECE_VALUE[QUEEN_ID / 2] - PIECE_VALUE[ROOK_ID / 2] + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Registry
+////////////////////////////////////////////////////////////////////////////////////////////////
+const int MAX_ENDGAMES = 16;
+static Endgame ENDGAMES[MAX_ENDGAMES];
+static int numEndgames = 0;
+
+static void addEndgame(const char* code, EndgameFn evaluate)
+{
+    for (int strongSide = WHITE; strongSide <= BLACK; strongSide++)
+    {
+        ENDGAMES[numEndgames++] = {materialKeyOf(code, strongSide), evaluate, strongSide};
+    }
+}
+
+Key materialKeyOf(const char* code, int strongSide)
+{
+    const char* letters = "KQRBNP"; // In piece type order
+    int count[12] = {};
+    int color = strongSide;
+    Key key = 0;
+    for (const char* c = code; *c; c++)
+    {
+        if (*c == 'K' && c != code)
+        {
+            color = strongSide ^ 1;
+        }
+        int pieceID = int(strchr(letters, *c) - letters) * 2 + color;
+        key ^= ZOBRIST_PIECE[pieceID][count[pieceID]++];
+    }
+    return key;
+}
+
+static void registerEndgames()
+{
+    initBitboards();
+    initZobrist();
+    initKPK();
+    addEndgame("KQK", evaluateKXK);
+    addEndgame("KRK", evaluateKXK);
+    addEndgame("KBNK", evaluateKBNK);
+    addEndgame("KPK", evaluateKPK);
+    addEndgame("KQKR", evaluateKQKR);
+}
+
+void initEndgames()
+{
+    static once_flag once;
+    call_once(once, registerEndgames);
+}
+
+const Endgame* findEndgame(Key materialKey)
+{
+    for (int i = 0; i < numEndgames; i++)
+    {
+        if (ENDGAMES[i].materialKey == materialKey)
+        {
+            return &ENDGAMES[i];
+        }
+    }
+    return nullptr;
+}
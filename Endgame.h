@@ -0,0 +1,31 @@
+//
+//  Endgame.h
+//  Chess
+//
+
+#ifndef ENDGAME_INCLUDED
+#define ENDGAME_INCLUDED
+
+#include "Zobrist.h"
+
+class Board;
+
+const int KNOWN_WIN = 10000; // Won for sure, but with no mate in sight; well below any mate score
+
+// Exact evaluation of one material signature. Returns the score from strongSide's point of view.
+typedef int (*EndgameFn)(const Board& b, int strongSide);
+
+struct Endgame
+{
+    Key materialKey;
+    EndgameFn evaluate;
+    int strongSide;
+};
+
+void initEndgames(); // Builds the KPK bitbase and the registry. Safe to call more than once, from any thread.
+const Endgame* findEndgame(Key materialKey); // Returns the specialized evaluator for this material, or nullptr.
+Key materialKeyOf(const char* code, int strongSide); // Material key of a signature like "KBNK", the strong side's pieces first.
+
+bool probeKPK(int strongSide, int strongKing, int strongPawn, int weakKing, int sideToMove); // True if the side with the pawn wins.
+
+#endif /* ENDGAME_INCLUDED */
@@ -7,27 +7,30 @@
 
 #include "Engine.h"
 #include "Board.h"
+#include "MoveGen.h"
+#include "Nnue.h"
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <math.h>
 #include <GLUT/glut.h>
 
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
 using namespace std;
 
+// First and last texture index drawn by each screen
+static const int SCREEN_TEXTURES[NUM_SCREENS][2] = {{12, 13}, {0, 11}, {14, 17}};
+static const char* SCREEN_TRACE[NUM_SCREENS] = {"uploaded menu textures", "uploaded gameplay textures", "uploaded end screen textures"};
+
+// PNGs are decoded in the order the screens are normally reached
+static const int DECODE_ORDER[NUM_TEXTURES] = {12, 13, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 14, 15, 16, 17};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTOR/DESTRUCTOR
 ////////////////////////////////////////////////////////////////////////////////////////////////
 Engine::Engine()
  : b(new Board)
-{
-    if (!loadAssets())
-    {
-        cerr << "FAILURE LOADING ASSETS" << endl;
-        exit(-999);
-    }
-}
+{}
 
 Engine::~Engine()
 {
@@ -45,6 +48,7 @@ Engine::~Engine()
 
 void reshapeCallback(int w, int h)
 {
+    Eng().requestRedraw();
 }
 
 void displayCallback()
@@ -52,6 +56,16 @@ void displayCallback()
     Eng().displayControl();
 }
 
+void frameTimerCallback(int)
+{
+    Eng().frameTimer();
+}
+
+void searchTimerCallback(int)
+{
+    Eng().pollSearch();
+}
+
 void mouseCallback(int button, int state, int x, int y)
 {
     Eng().mouseControl(button, state, x, y);
@@ -59,6 +73,23 @@ void mouseCallback(int button, int state, int x, int y)
 
 void Engine::run(int argc, char* argv[])
 {
+    traceStartup("run");
+    string baseDir = executableDir(argv[0]); // Before glutInit, which may rewrite argv
+    
+    // Assets live next to the binary: assets.pack if it was built, otherwise assets/*.png,
+    // which are decoded in the background while the window comes up
+    if (!m_assets.load(baseDir, DECODE_ORDER))
+    {
+        cerr << "FAILURE LOADING ASSETS" << endl;
+        exit(-999);
+    }
+    
+    // The computer plays with the network if one was put next to the binary, otherwise with the classical evaluation
+    if (loadNetwork(baseDir + "/" + NNUE_FILE))
+    {
+        cout << "evaluating with " << NNUE_FILE << " (" << nnueKernels() << ")" << endl;
+    }
+    
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGB | GLUT_DEPTH | GLUT_DOUBLE);
     
@@ -66,10 +97,12 @@ void Engine::run(int argc, char* argv[])
     glutInitWindowPosition(0, 0);
     glutCreateWindow("Chess");
     glViewport(VP_BORDER, VP_BORDER, VP_HEIGHT, VP_WIDTH);
+    traceStartup("created window");
+    buildAtlas();
+    buildBoardGeometry();
     
     glutReshapeFunc(reshapeCallback);
-    glutDisplayFunc(displayCallback);
-    glutIdleFunc(displayCallback);
+    glutDisplayFunc(displayCallback); // No idle function: frames are only drawn after requestRedraw()
     
     glutMouseFunc(mouseCallback);
 
@@ -80,8 +113,35 @@ void Engine::run(int argc, char* argv[])
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // CONTROL
 ////////////////////////////////////////////////////////////////////////////////////////////////
+void Engine::requestRedraw()
+{
+    if (m_redrawPending)
+    {
+        return;
+    }
+    m_redrawPending = true;
+    
+    if (FRAME_CAP <= 0)
+    {
+        glutPostRedisplay();
+        return;
+    }
+    
+    // Hold the frame back until a full frame interval has passed since the last one
+    int wait = m_lastFrameTime + 1000 / FRAME_CAP - glutGet(GLUT_ELAPSED_TIME);
+    glutTimerFunc(max(wait, 0), frameTimerCallback, 0);
+}
+
+void Engine::frameTimer()
+{
+    glutPostRedisplay();
+}
+
 void Engine::displayControl()
 {
+    m_redrawPending = false;
+    m_lastFrameTime = glutGet(GLUT_ELAPSED_TIME);
+    
     switch(m_gameState)
     {
         case 0:
@@ -97,6 +157,11 @@ void Engine::displayControl()
             displayEndScreen(true);
             break;
     }
+    
+    if (m_framesDrawn++ == 0)
+    {
+        traceStartup("drew first frame");
+    }
 }
 
 void Engine::mouseControl(int button, int state, int x, int y)
@@ -120,6 +185,9 @@ void Engine::mouseControl(int button, int state, int x, int y)
             mouseEndScreen(button, state, x, y);
             break;
     }
+    // Any click can change the selection, the position or the screen
+    refreshMoveTargets();
+    requestRedraw();
 }
 
 
@@ -128,6 +196,7 @@ void Engine::mouseControl(int button, int state, int x, int y)
 ////////////////////////////////////////////////////////////////////////////////////////////////
 void Engine::displayMenu()
 {
+    uploadScreenTextures(SCREEN_MENU);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     drawBackdrop();
@@ -138,6 +207,7 @@ void Engine::displayMenu()
 
 void Engine::displayGameplay()
 {
+    uploadScreenTextures(SCREEN_GAMEPLAY);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     drawBoard();
@@ -152,6 +222,7 @@ void Engine::displayGameplay()
 
 void Engine::displayEndScreen(bool draw)
 {
+    uploadScreenTextures(SCREEN_END);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
     drawBackdrop();
@@ -174,10 +245,22 @@ void Engine::mouseMenu(int button, int state, int x, int y)
     {
         m_gameState = 1;
     }
+    // Click on Player vs. Computer
+    if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN && x >= 385 && x <= 665 && y >= 280 && y <= 420)
+    {
+        m_vsComputer = true;
+        m_computerClockMs = COMPUTER_CLOCK_MS;
+        m_gameState = 1;
+        startComputerMove();
+    }
 }
 
 void Engine::mouseGameplay(int button, int state, int x, int y)
 {
+    if (computerToMove()) // The board is the computer's until its search finishes
+    {
+        return;
+    }
     if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN && x >= VP_BORDER && x <= VP_WIDTH + VP_BORDER && y >= VP_BORDER && y <= VP_HEIGHT + VP_BORDER)
     {
         x -= VP_BORDER;
@@ -205,19 +288,17 @@ void Engine::mouseGameplay(int button, int state, int x, int y)
             Piece* piece = b->pieceAtPos(selectedR, selectedC);
             if (piece != nullptr && b->totalMoves() % 2 == piece->color() && b->attemptMove(piece, newR, newC))
             {
+                ppMenu(b->promotionPending());
                 selectionToggled = false;
                 lastSelR = newR;
                 lastSelC = newC;
                 
                 selectedR = -1;
                 selectedC = -1;
-                if (b->kingCheckmated(b->totalMoves() % 2))
+                if (!m_ppMenu) // A pending promotion is checked once the piece has been chosen
                 {
-                    m_gameState = 2;
-                }
-                else if (b->kingStalemated(b->totalMoves() % 2))
-                {
-                    m_gameState = 3;
+                    updateGameState();
+                    startComputerMove();
                 }
             }
             else
@@ -242,6 +323,8 @@ void Engine::mousePawnPromotion(int button, int state, int x, int y)
         int promotionID = 2 + (2 * (abs(lastSelR) - row)) + ((b->totalMoves() + 1) % 2);
         b->promotePawn(b->pieceAtPos(lastSelR, lastSelC), promotionID);
         ppMenu(false);
+        updateGameState();
+        startComputerMove();
     }
 }
 
@@ -262,210 +345,247 @@ void Engine::mouseEndScreen(int button, int state, int x, int y)
 ////////////////////////////////////////////////////////////////////////////////////////////////
 void Engine::drawPieces()
 {
-    // TEXTURE
-    glEnable(GL_TEXTURE_2D);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    
-    // Makes background for texture transparent (as opposed to black)
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
     const float PIECE_SIZE = 0.20;
     
-    // Draw white
-    for (int i = 0; i < b->pieces(WHITE).size(); i++)
+    for (int color = WHITE; color <= BLACK; color++)
     {
-        if (b->pieces(WHITE)[i]->alive())
+        for (int i = 0; i < b->numPieces(color); i++)
         {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pieceWidth, pieceHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[b->pieces(WHITE)[i]->pieceID()]);
+            Piece* piece = &b->pieces(color)[i];
             
-            float xCoord = (0.25 * b->pieces(WHITE)[i]->col() - 1.0) - (0.25 - PIECE_SIZE)/2;
-            float yCoord = (0.25 * b->pieces(WHITE)[i]->row() - 1.0) - (0.25 - PIECE_SIZE)/2;
+            float xCoord = (0.25 * piece->col() - 1.0) - (0.25 - PIECE_SIZE)/2;
+            float yCoord = (0.25 * piece->row() - 1.0) - (0.25 - PIECE_SIZE)/2;
             
-            glBegin(GL_QUADS);
-            glTexCoord2f(1.0, 1.0); glVertex2f(xCoord, yCoord);
-            glTexCoord2f(0.0, 1.0); glVertex2f(xCoord - PIECE_SIZE,  yCoord);
-            glTexCoord2f(0.0, 0.0); glVertex2f(xCoord - PIECE_SIZE, yCoord - PIECE_SIZE);
-            glTexCoord2f(1.0, 0.0); glVertex2f(xCoord, yCoord - PIECE_SIZE);
-            glEnd();
+            queueSprite(piece->pieceID(), xCoord, yCoord, PIECE_SIZE, PIECE_SIZE);
         }
     }
-    
-    // Draw black
-    for (int i = 0; i < b->pieces(BLACK).size(); i++)
+    flushSprites();
+}
+
+// Fills rgb with the colour of square (r, c); highlighted squares use the darker selection shades
+static void squareColor(int r, int c, bool highlighted, float rgb[3])
+{
+    if (highlighted)
     {
-        if (b->pieces(BLACK)[i]->alive())
+        if (r % 2 == c % 2) // Black squares
         {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pieceWidth, pieceHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[b->pieces(BLACK)[i]->pieceID()]);
-            
-            float xCoord = (0.25 * b->pieces(BLACK)[i]->col() - 1.0) - (0.25 - PIECE_SIZE)/2;
-            float yCoord = (0.25 * b->pieces(BLACK)[i]->row() - 1.0) - (0.25 - PIECE_SIZE)/2;
-            
-            glBegin(GL_QUADS);
-            glTexCoord2f(1.0, 1.0); glVertex2f(xCoord, yCoord);
-            glTexCoord2f(0.0, 1.0); glVertex2f(xCoord - PIECE_SIZE,  yCoord);
-            glTexCoord2f(0.0, 0.0); glVertex2f(xCoord - PIECE_SIZE, yCoord - PIECE_SIZE);
-            glTexCoord2f(1.0, 0.0); glVertex2f(xCoord, yCoord - PIECE_SIZE);
-            glEnd();
+            rgb[0] = 106.0/255.0;
+            rgb[1] = 111.0/255.0;
+            rgb[2] = 65.0/255.0;
+        }
+        else // White squares
+        {
+            rgb[0] = 134.0/255.0;
+            rgb[1] = 151.0/255.0;
+            rgb[2] = 105.0/255.0;
+        }
+    }
+    else
+    {
+        if (r % 2 == c % 2) // Black squares
+        {
+            rgb[0] = 181.0/255.0;
+            rgb[1] = 136.0/255.0;
+            rgb[2] = 99.0/255.0;
+        }
+        else // White squares
+        {
+            rgb[0] = 240.0/255.0;
+            rgb[1] = 217.0/255.0;
+            rgb[2] = 181.0/255.0;
         }
     }
-    glDisable(GL_TEXTURE_2D);
 }
 
-void Engine::drawBoard()
+static void pushVertex(vector<ColorVertex>& vertices, float x, float y, const float rgb[3])
+{
+    ColorVertex v = {x, y, rgb[0], rgb[1], rgb[2]};
+    vertices.push_back(v);
+}
+
+// Appends square (r, c) as two triangles
+static void pushSquare(vector<ColorVertex>& vertices, int r, int c, const float rgb[3])
 {
-    float coordY = -0.75;
+    float left = 0.25 * (c - 1) - 1.0;
+    float right = 0.25 * c - 1.0;
+    float bottom = 0.25 * (r - 1) - 1.0;
+    float top = 0.25 * r - 1.0;
+    
+    pushVertex(vertices, left, top, rgb);
+    pushVertex(vertices, left, bottom, rgb);
+    pushVertex(vertices, right, bottom, rgb);
+    
+    pushVertex(vertices, left, top, rgb);
+    pushVertex(vertices, right, bottom, rgb);
+    pushVertex(vertices, right, top, rgb);
+}
+
+// Draws count triangle vertices from a buffer of ColorVertex
+static void drawColorVertices(unsigned int vbo, int count)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(ColorVertex), reinterpret_cast<void*>(offsetof(ColorVertex, x)));
+    glColorPointer(3, GL_FLOAT, sizeof(ColorVertex), reinterpret_cast<void*>(offsetof(ColorVertex, r)));
+    glDrawArrays(GL_TRIANGLES, 0, count);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Engine::buildBoardGeometry()
+{
+    // The squares never change, so they go to the GPU once
+    vector<ColorVertex> vertices;
+    vertices.reserve(64 * 6);
     for (int r = 1; r <= 8; r++)
     {
-        float coordX = -0.75;
         for (int c = 1; c <= 8; c++)
         {
-            float red;
-            float green;
-            float blue;
-            if (selectionToggled && r == selectedR && c == selectedC && b->pieceAtPos(selectedR, selectedC) != nullptr) // Selected Square
-            {
-                if (r % 2 == c % 2) // Black squares
-                {
-                    red = 106.0/255.0;
-                    green = 111.0/255.0;
-                    blue = 65.0/255.0;
-                }
-                else // White squares
-                {
-                    red = 134.0/255.0;
-                    green = 151.0/255.0;
-                    blue = 105.0/255.0;
-                }
-            }
-            else
-            {
-                if (r % 2 == c % 2) // Black squares
-                {
-                    red = 181.0/255.0;
-                    green = 136.0/255.0;
-                    blue = 99.0/255.0;
-                }
-                else // White squares
-                {
-                    red = 240.0/255.0;
-                    green = 217.0/255.0;
-                    blue = 181.0/255.0;
-                }
-            }
-            
-            glColor3f(red, green, blue);
-            
-            glBegin(GL_QUADS);
-            glVertex2f(coordX - 0.25, coordY);
-            glVertex2f(coordX - 0.25, coordY - 0.25);
-            glVertex2f(coordX, coordY - 0.25);
-            glVertex2f(coordX, coordY);
-            glEnd();
-            
-            coordX += 0.25;
+            float rgb[3];
+            squareColor(r, c, false, rgb);
+            pushSquare(vertices, r, c, rgb);
         }
-        coordY += 0.25;
     }
-    if (selectionToggled == true)
+    m_boardVertexCount = static_cast<int>(vertices.size());
+    
+    glGenBuffers(1, &m_boardVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_boardVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ColorVertex), &vertices[0], GL_STATIC_DRAW);
+    
+    // Highlights and move markers are rebuilt into this one whenever they are drawn
+    glGenBuffers(1, &m_overlayVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Engine::drawBoard()
+{
+    drawColorVertices(m_boardVBO, m_boardVertexCount);
+    
+    m_overlay.clear();
+    Piece* selected = selectionToggled ? b->pieceAtPos(selectedR, selectedC) : nullptr;
+    if (selected != nullptr) // Selected Square
     {
-        drawPossibleMoves(b->pieceAtPos(selectedR, selectedC));
+        float rgb[3];
+        squareColor(selectedR, selectedC, true, rgb);
+        pushSquare(m_overlay, selectedR, selectedC, rgb);
+        drawPossibleMoves();
+    }
+    
+    if (!m_overlay.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_overlayVBO);
+        glBufferData(GL_ARRAY_BUFFER, m_overlay.size() * sizeof(ColorVertex), &m_overlay[0], GL_STREAM_DRAW);
+        drawColorVertices(m_overlayVBO, static_cast<int>(m_overlay.size()));
     }
 }
 
-void Engine::drawPossibleMoves(Piece* piece)
+void Engine::refreshMoveTargets()
 {
-    if (piece == nullptr)
+    int from = selectionToggled ? makeSquare(selectedR, selectedC) : NO_SQUARE;
+    if (from == m_targetsFrom && b->key() == m_targetsKey)
     {
         return;
     }
+    m_targetsFrom = from;
+    m_targetsKey = b->key();
+    m_moveTargets = 0;
+    m_losingCaptures = 0;
     
-    for (int r = 1; r <= 8; r++)
+    if (from == NO_SQUARE)
     {
-        for (int c = 1; c <= 8; c++)
+        return;
+    }
+    
+    // Only the side to move has legal moves, so the other side's pieces get an empty set
+    Move moves[MAX_MOVES];
+    Move* end = generateLegalMoves(*b, moves);
+    for (Move* m = moves; m != end; m++)
+    {
+        if (moveFrom(*m) == from)
         {
-            if (b->totalMoves() % 2 == piece->color() && piece->movePossible(r, c))
+            m_moveTargets |= squareBB(moveTo(*m));
+            if (b->isCapture(*m) && !b->see(*m, 0))
             {
-                float red;
-                float green;
-                float blue;
-                if (r % 2 == c % 2)
-                {
-                    red = 106.0/255.0;
-                    green = 111.0/255.0;
-                    blue = 65.0/255.0;
-                }
-                else
-                {
-                    red = 134.0/255.0;
-                    green = 151.0/255.0;
-                    blue = 105.0/255.0;
-                }
-                if (b->pieceAtPos(r, c) == nullptr)
-                {
-                    // radius, and center coordinate of octagon
-                    float octRad = 0.03125;
-                    float octX = 0.25 * c - 1.00 - 0.125;
-                    float octY = 0.25 * r - 1.00 - 0.125;
-                    // The distance to the diag along the x/y axis -- a^2 + b^2 = octRad^2; 2a^2 = octRad^2; a = sqrt(octRad^2)/sqrt(2)
-                    float octDiag = sqrt(octRad * octRad)/sqrt(2.0);
-                    
-                    glColor3f(red, green, blue);
-                    glBegin(GL_POLYGON);
-                    glVertex2f(octX, octY + octRad);
-                    glVertex2f(octX - octDiag, octY + octDiag);
-                    glVertex2f(octX - octRad, octY);
-                    glVertex2f(octX - octDiag, octY - octDiag);
-                    glVertex2f(octX, octY - octRad);
-                    glVertex2f(octX + octDiag, octY - octDiag);
-                    glVertex2f(octX + octRad, octY);
-                    glVertex2f(octX + octDiag, octY + octDiag);
-                    glEnd();
-                }
-                else
-                {
-                    float triBase = 0.05;
-                    
-                    float topRightX = 0.25 * c - 1.0;
-                    float topRightY = 0.25 * r - 1.0;
-                    
-                    float topLeftX = 0.25 * (c - 1) - 1.0;
-                    float topLeftY = 0.25 * r - 1.0;
-                    
-                    float botLeftX = 0.25 * (c - 1) - 1.0;
-                    float botLeftY = 0.25 * (r - 1) - 1.0;
-                    
-                    float botRightX = 0.25 * c - 1.0;
-                    float botRightY = 0.25 * (r-1) - 1.0;
-
-                    glColor3f(red, green, blue);
-                    
-                    glBegin(GL_TRIANGLES);
-                    glVertex2f(topRightX, topRightY);
-                    glVertex2f(topRightX - triBase, topRightY);
-                    glVertex2f(topRightX, topRightY - triBase);
-                    
-                    glVertex2f(topLeftX, topLeftY);
-                    glVertex2f(topLeftX, topLeftY - triBase);
-                    glVertex2f(topLeftX + triBase, topLeftY);
-                    
-                    glVertex2f(botLeftX, botLeftY);
-                    glVertex2f(botLeftX + triBase, botLeftY);
-                    glVertex2f(botLeftX, botLeftY + triBase);
-                    
-                    glVertex2f(botRightX, botRightY);
-                    glVertex2f(botRightX - triBase, botRightY);
-                    glVertex2f(botRightX, botRightY + triBase);
-                    glEnd();
-                }
+                m_losingCaptures |= squareBB(moveTo(*m));
             }
         }
     }
 }
 
+void Engine::drawPossibleMoves()
+{
+    Bitboard targets = m_moveTargets;
+    while (targets)
+    {
+        int sq = popLsb(targets);
+        int r = squareRow(sq);
+        int c = squareCol(sq);
+        float rgb[3];
+        squareColor(r, c, true, rgb);
+        if (m_losingCaptures & squareBB(sq))
+        {
+            rgb[0] = 176.0/255.0;
+            rgb[1] = 72.0/255.0;
+            rgb[2] = 58.0/255.0;
+        }
+        if (b->pieceIDAt(sq) < 0)
+        {
+            // radius, and center coordinate of octagon
+            float octRad = 0.03125;
+            float octX = 0.25 * c - 1.00 - 0.125;
+            float octY = 0.25 * r - 1.00 - 0.125;
+            // The distance to the diag along the x/y axis -- a^2 + b^2 = octRad^2; 2a^2 = octRad^2; a = sqrt(octRad^2)/sqrt(2)
+            float octDiag = sqrt(octRad * octRad)/sqrt(2.0);
+            
+            const float rimX[8] = {0, -octDiag, -octRad, -octDiag, 0, octDiag, octRad, octDiag};
+            const float rimY[8] = {octRad, octDiag, 0, -octDiag, -octRad, -octDiag, 0, octDiag};
+            
+            // Fan of triangles around the centre
+            for (int i = 0; i < 8; i++)
+            {
+                int next = (i + 1) % 8;
+                pushVertex(m_overlay, octX, octY, rgb);
+                pushVertex(m_overlay, octX + rimX[i], octY + rimY[i], rgb);
+                pushVertex(m_overlay, octX + rimX[next], octY + rimY[next], rgb);
+            }
+        }
+        else
+        {
+            float triBase = 0.05;
+            
+            float topRightX = 0.25 * c - 1.0;
+            float topRightY = 0.25 * r - 1.0;
+            
+            float topLeftX = 0.25 * (c - 1) - 1.0;
+            float topLeftY = 0.25 * r - 1.0;
+            
+            float botLeftX = 0.25 * (c - 1) - 1.0;
+            float botLeftY = 0.25 * (r - 1) - 1.0;
+            
+            float botRightX = 0.25 * c - 1.0;
+            float botRightY = 0.25 * (r-1) - 1.0;
+            
+            pushVertex(m_overlay, topRightX, topRightY, rgb);
+            pushVertex(m_overlay, topRightX - triBase, topRightY, rgb);
+            pushVertex(m_overlay, topRightX, topRightY - triBase, rgb);
+            
+            pushVertex(m_overlay, topLeftX, topLeftY, rgb);
+            pushVertex(m_overlay, topLeftX, topLeftY - triBase, rgb);
+            pushVertex(m_overlay, topLeftX + triBase, topLeftY, rgb);
+            
+            pushVertex(m_overlay, botLeftX, botLeftY, rgb);
+            pushVertex(m_overlay, botLeftX + triBase, botLeftY, rgb);
+            pushVertex(m_overlay, botLeftX, botLeftY + triBase, rgb);
+            
+            pushVertex(m_overlay, botRightX, botRightY, rgb);
+            pushVertex(m_overlay, botRightX - triBase, botRightY, rgb);
+            pushVertex(m_overlay, botRightX, botRightY + triBase, rgb);
+        }
+    }
+}
+
 void Engine::drawPawnPromotion()
 {
     float xCoord = 0.25 * lastSelC - 1.0;
@@ -487,16 +607,6 @@ void Engine::drawPawnPromotion()
     glVertex2f(xCoord, yCoord - 1.0);
     glEnd();
     
-    glEnable(GL_TEXTURE_2D);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    
-    // Makes background for texture transparent (as opposed to black)
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
     const float PIECE_SIZE = 0.20;
     
     if (lastSelR == 8)
@@ -512,19 +622,12 @@ void Engine::drawPawnPromotion()
     yCoord -= ((0.25 - PIECE_SIZE)/2.0);
     for (int i = 1; i <= 4; i++)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pieceWidth, pieceHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[(i * 2) + ((b->totalMoves() - 1) % 2)]);
-                
-        glBegin(GL_QUADS);
-        glTexCoord2f(1.0, 1.0); glVertex2f(xCoord, yCoord);
-        glTexCoord2f(0.0, 1.0); glVertex2f(xCoord - PIECE_SIZE,  yCoord);
-        glTexCoord2f(0.0, 0.0); glVertex2f(xCoord - PIECE_SIZE, yCoord - PIECE_SIZE);
-        glTexCoord2f(1.0, 0.0); glVertex2f(xCoord, yCoord - PIECE_SIZE);
-        glEnd();
+        queueSprite((i * 2) + ((b->totalMoves() - 1) % 2), xCoord, yCoord, PIECE_SIZE, PIECE_SIZE);
         
         float dir = (-2.0 * (b->totalMoves() % 2) + 1);
         yCoord += (0.25 * dir);
     }
-    glDisable(GL_TEXTURE_2D);
+    flushSprites();
 }
 
 void Engine::drawBackdrop()
@@ -544,36 +647,9 @@ void Engine::drawMainMenu()
     float buttonW = 0.8;
     float buttonH = 0.4;
 
-    glEnable(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE, GL_REPLACE);
-
-    // Makes background for texture transparent (as opposed to black)
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buttonWidth, buttonHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[12]);
-    
-    glBegin(GL_QUADS);
-    glTexCoord2f(1.0, 1.0); glVertex2f(-0.1, 0.2);
-    glTexCoord2f(0.0, 1.0); glVertex2f(-0.1 - buttonW, 0.2);
-    glTexCoord2f(0.0, 0.0); glVertex2f(-0.1 - buttonW, 0.2 - buttonH);
-    glTexCoord2f(1.0, 0.0); glVertex2f(-0.1, 0.2 - buttonH);
-    glEnd();
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buttonWidth, buttonHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[13]);
-
-    glBegin(GL_QUADS);
-    glTexCoord2f(1.0, 1.0); glVertex2f(0.9, 0.2);
-    glTexCoord2f(0.0, 1.0); glVertex2f(0.9 - buttonW, 0.2);
-    glTexCoord2f(0.0, 0.0); glVertex2f(0.9 - buttonW, 0.2 - buttonH);
-    glTexCoord2f(1.0, 0.0); glVertex2f(0.9, 0.2 - buttonH);
-    glEnd();
-
-
-    glDisable(GL_TEXTURE_2D);
+    queueSprite(12, -0.1, 0.2, buttonW, buttonH);
+    queueSprite(13, 0.9, 0.2, buttonW, buttonH);
+    flushSprites();
 }
 
 void Engine::drawEndScreen(bool draw)
@@ -587,78 +663,290 @@ void Engine::drawEndScreen(bool draw)
     {
         textureIndex = 14 + ((b->totalMoves() + 1) % 2);
     }
-    glEnable(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE, GL_REPLACE);
-
-    // Makes background for texture transparent (as opposed to black)
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     // OUTCOME BANNER
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buttonWidth, buttonHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[textureIndex]);
-    
-    glBegin(GL_QUADS);
-    glTexCoord2f(1.0, 1.0); glVertex2f(0.6, 0.6);
-    glTexCoord2f(0.0, 1.0); glVertex2f(-0.6, 0.6);
-    glTexCoord2f(0.0, 0.0); glVertex2f(-0.6, 0.0);
-    glTexCoord2f(1.0, 0.0); glVertex2f(0.6, 0.0);
-    glEnd();
+    queueSprite(textureIndex, 0.6, 0.6, 1.2, 0.6);
     
     // EXIT BUTTON
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buttonWidth, buttonHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[17]);
+    queueSprite(17, 0.2, -0.2, 0.4, 0.2);
     
-    glBegin(GL_QUADS);
-    glTexCoord2f(1.0, 1.0); glVertex2f(0.2, -0.2);
-    glTexCoord2f(0.0, 1.0); glVertex2f(-0.2, -0.2);
-    glTexCoord2f(0.0, 0.0); glVertex2f(-0.2, -0.4);
-    glTexCoord2f(1.0, 0.0); glVertex2f(0.2, -0.4);
-    glEnd();
+    flushSprites();
+}
 
-    glDisable(GL_TEXTURE_2D);
+bool Engine::computerToMove()
+{
+    return m_vsComputer && m_gameState == 1 && b->sideToMove() == COMPUTER_COLOR;
+}
+
+void Engine::startComputerMove()
+{
+    // Settle the search that ran on the human's time, if any
+    bool ponderHit = false;
+    if (m_ponderMove != MOVE_NONE && !computerToMove()) // The human's move ended the game
+    {
+        m_search.stop();
+    }
+    else if (m_ponderMove != MOVE_NONE)
+    {
+        ponderHit = b->key() == m_ponderKey;
+        if (ponderHit)
+        {
+            m_ponderHits++;
+        }
+        else
+        {
+            m_ponderMisses++;
+            m_search.stop(); // Returns within a few thousand nodes
+        }
+        cout << "ponder " << (ponderHit ? "hit" : "miss") << " on " << moveToString(m_ponderMove)
+             << ", hit rate " << m_ponderHits << "/" << (m_ponderHits + m_ponderMisses) << endl;
+    }
+    m_ponderMove = MOVE_NONE;
+    
+    if (!computerToMove())
+    {
+        return;
+    }
+    if (ponderHit)
+    {
+        // Same search, same TT, same depth; it just gets a deadline now
+        m_search.ponderHit();
+    }
+    else
+    {
+        m_search.start(*b, computerLimits(false));
+    }
+    m_ponderHit = ponderHit;
+    m_thinkStartTime = glutGet(GLUT_ELAPSED_TIME); // The computer's clock runs from here, even after pondering
+    m_reportedDepth = 0;
+    glutTimerFunc(SEARCH_POLL_MS, searchTimerCallback, 0);
+}
+
+SearchLimits Engine::computerLimits(bool ponder)
+{
+    SearchLimits limits;
+    if (COMPUTER_CLOCK_MS > 0)
+    {
+        limits.timeMs = max(m_computerClockMs, 1);
+        limits.incrementMs = COMPUTER_INCREMENT_MS;
+    }
+    else
+    {
+        limits.moveTimeMs = COMPUTER_MOVE_TIME_MS;
+    }
+    limits.ponder = ponder;
+    return limits;
 }
 
-bool Engine::loadAssets()
+void Engine::startPondering(Move expectedReply)
 {
-    // LOAD IMAGES
-    stbi_set_flip_vertically_on_load(true);
-    texture_data[0] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/king_white.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
-    texture_data[1] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/king_black.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
+    if (!COMPUTER_PONDERS || expectedReply == MOVE_NONE || m_gameState != 1)
+    {
+        return;
+    }
+    Board ponderBoard = *b;
+    ponderBoard.doMove(expectedReply);
     
-    texture_data[2] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/queen_white.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
-    texture_data[3] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/queen_black.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
+    m_search.start(ponderBoard, computerLimits(true));
+    m_ponderMove = expectedReply;
+    m_ponderKey = ponderBoard.key();
+}
+
+void Engine::pollSearch()
+{
+    // Reading the snapshot never waits on the search thread, so frames keep coming while it thinks
+    SearchInfo info = m_search.info();
+#ifdef TRACE_SEARCH // Prints each completed iteration, when built with -DTRACE_SEARCH
+    if (info.depth > m_reportedDepth)
+    {
+        m_reportedDepth = info.depth;
+        cout << "depth " << info.depth << " score " << info.score << " nodes " << info.nodes
+             << " best " << moveToString(info.bestMove) << endl;
+    }
+#endif
+    if (!info.finished)
+    {
+        glutTimerFunc(SEARCH_POLL_MS, searchTimerCallback, 0);
+        return;
+    }
     
-    texture_data[4] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/rook_white.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
-    texture_data[5] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/rook_black.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
+    m_search.stop(); // Already done; joins the worker
+    cout << "pawn hash hit rate " << m_search.pawnHitRate() * 100 << "%, eval cache hit rate "
+         << m_search.evalCacheHitRate() * 100 << "%" << endl;
+    int thinkMs = glutGet(GLUT_ELAPSED_TIME) - m_thinkStartTime;
+    if (COMPUTER_CLOCK_MS > 0)
+    {
+        m_computerClockMs += COMPUTER_INCREMENT_MS - thinkMs;
+#ifdef TRACE_SEARCH
+        cout << "computer clock " << m_computerClockMs / 1000.0 << " s" << endl;
+#endif
+    }
+    if (m_ponderHit)
+    {
+        int saved = max(0, m_search.softLimitMs() - thinkMs);
+        m_ponderSavedMs += saved;
+        cout << "pondering saved " << saved << " ms, " << m_ponderSavedMs << " ms this game" << endl;
+    }
+    if (info.bestMove != MOVE_NONE)
+    {
+        b->doMove(info.bestMove);
+    }
+    updateGameState();
+    startPondering(info.ponderMove);
+    refreshMoveTargets();
+    requestRedraw();
+}
+
+void Engine::updateGameState()
+{
+    switch (b->gameStatus())
+    {
+        case GAME_CHECKMATE:
+            cout << (b->sideToMove() == BLACK ? "WHITE WINS" : "BLACK WINS") << endl;
+            m_gameState = 2;
+            break;
+        case GAME_STALEMATE:
+        case GAME_DRAW_REPETITION:
+        case GAME_DRAW_FIFTY_MOVES:
+        case GAME_DRAW_MATERIAL:
+            cout << "IT'S A DRAW" << endl;
+            m_gameState = 3;
+            break;
+    }
+}
+
+void Engine::buildAtlas()
+{
+    // Shelf packing: sprites go left to right in rows as tall as the tallest sprite in the row.
+    // Sorting by height keeps the rows tight (pieces share rows, banners share rows).
+    int order[NUM_TEXTURES];
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        order[i] = i;
+    }
+    sort(order, order + NUM_TEXTURES, [this](int a, int b) { return m_assets.height(a) > m_assets.height(b); });
+    
+    int x[NUM_TEXTURES];
+    int y[NUM_TEXTURES];
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfH = 0;
+    for (int k = 0; k < NUM_TEXTURES; k++)
+    {
+        int i = order[k];
+        if (shelfX + m_assets.width(i) > ATLAS_WIDTH)
+        {
+            shelfY += shelfH + ATLAS_PADDING;
+            shelfX = 0;
+            shelfH = 0;
+        }
+        x[i] = shelfX;
+        y[i] = shelfY;
+        shelfX += m_assets.width(i) + ATLAS_PADDING;
+        shelfH = max(shelfH, m_assets.height(i));
+    }
     
-    texture_data[6] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/bishop_white.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
-    texture_data[7] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/bishop_black.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
+    m_atlasHeight = 1;
+    while (m_atlasHeight < shelfY + shelfH)
+    {
+        m_atlasHeight *= 2;
+    }
     
-    texture_data[8] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/knight_white.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
-    texture_data[9] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/knight_black.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        m_atlasX[i] = x[i];
+        m_atlasY[i] = y[i];
+        m_sprites[i].u0 = float(x[i]) / ATLAS_WIDTH;
+        m_sprites[i].v0 = float(y[i]) / m_atlasHeight;
+        m_sprites[i].u1 = float(x[i] + m_assets.width(i)) / ATLAS_WIDTH;
+        m_sprites[i].v1 = float(y[i] + m_assets.height(i)) / m_atlasHeight;
+    }
     
-    texture_data[10] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/pawn_white.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
-    texture_data[11] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/pawn_black.png", &pieceWidth, &pieceHeight, &nrChannels, 0);
+    // The sheet starts out empty; each screen's images are copied in the first time it is drawn
+    unsigned char* blank = static_cast<unsigned char*>(calloc(ATLAS_WIDTH * m_atlasHeight, 4));
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_WIDTH, m_atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, blank);
+    free(blank);
+    traceStartup("allocated atlas");
+}
+
+void Engine::uploadScreenTextures(int screen)
+{
+    if (m_screenUploaded[screen])
+    {
+        return;
+    }
     
-    texture_data[12] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/button_vsPlayer.png", &buttonWidth, &buttonHeight, &nrChannels, 0);
-    texture_data[13] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/button_vsComputer.png", &buttonWidth, &buttonHeight, &nrChannels, 0);
+    int first = SCREEN_TEXTURES[screen][0];
+    int last = SCREEN_TEXTURES[screen][1];
+    if (!m_assets.waitFor(first, last))
+    {
+        cerr << "FAILURE LOADING ASSETS" << endl;
+        exit(-999);
+    }
     
-    texture_data[14] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/banner_whiteWins.png", &bannerWidth, &bannerHeight, &nrChannels, 0);
-    texture_data[15] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/banner_blackWins.png", &bannerWidth, &bannerHeight, &nrChannels, 0);
-    texture_data[16] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/banner_draw.png", &bannerWidth, &bannerHeight, &nrChannels, 0);
-    texture_data[17] = stbi_load("/Users/liumartin/Dropbox/Chess/Chess/assets/button_exit.png", &buttonWidth, &buttonHeight, &nrChannels, 0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    for (int i = first; i <= last; i++)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, m_atlasX[i], m_atlasY[i], m_assets.width(i), m_assets.height(i), GL_RGBA, GL_UNSIGNED_BYTE, m_assets.pixels(i));
+        m_assets.releaseImage(i);
+    }
+    m_screenUploaded[screen] = true;
+    traceStartup(SCREEN_TRACE[screen]);
     
-    for (int i = 0; i < NUM_TEXTURES; i++)
+    // Once every screen is in the atlas the decoders and the pack are no longer needed
+    for (int s = 0; s < NUM_SCREENS; s++)
     {
-        if (!texture_data[i])
+        if (!m_screenUploaded[s])
         {
-            std::cerr << "Texture at texture_data[" << i << "] not found!" << std::endl;
-            return false;
+            return;
         }
     }
-    return true;
+    m_assets.release();
+}
+
+void Engine::queueSprite(int textureIndex, float right, float top, float width, float height)
+{
+    const Sprite& s = m_sprites[textureIndex];
+    const float quad[16] = {
+        right,         top,          s.u1, s.v1,
+        right - width, top,          s.u0, s.v1,
+        right - width, top - height, s.u0, s.v0,
+        right,         top - height, s.u1, s.v0,
+    };
+    m_spriteBatch.insert(m_spriteBatch.end(), quad, quad + 16);
+}
+
+void Engine::flushSprites()
+{
+    if (m_spriteBatch.empty())
+    {
+        return;
+    }
+    
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    
+    // Makes background for texture transparent (as opposed to black)
+    glEnable(GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    
+    // Interleaved x, y, u, v; every queued quad goes out in one draw call
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), &m_spriteBatch[0]);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), &m_spriteBatch[2]);
+    glDrawArrays(GL_QUADS, 0, static_cast<int>(m_spriteBatch.size() / 4));
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    
+    glDisable(GL_TEXTURE_2D);
+    m_spriteBatch.clear();
 }
 
 void Engine::ppMenu(bool status)
@@ -9,10 +9,29 @@
 #define ENGINE_INCLUDED
 
 #include <iostream>
+#include <vector>
+#include "Bitboard.h"
+#include "Zobrist.h"
+#include "Assets.h"
+#include "Search.h"
 #include "globals.h"
 class Board;
 class Piece;
 
+// Where an image sits in the texture atlas, in texture coordinates
+struct Sprite
+{
+    float u0, v0; // Bottom left
+    float u1, v1; // Top right
+};
+
+// Coloured 2D vertex for the board and overlay buffers
+struct ColorVertex
+{
+    float x, y;
+    float r, g, b;
+};
+
 class Engine
 {
 public:
@@ -24,6 +43,8 @@ public:
     void run(int argc, char* argv[]);
     
     // CONTROLS
+    void requestRedraw(); // Marks the window as out of date; it is redrawn once, no sooner than FRAME_CAP allows.
+    void frameTimer();
     void displayControl();
     void mouseControl(int button, int state, int x, int y);
     
@@ -41,7 +62,8 @@ public:
     // Gameplay Display Functions
     void drawPieces();
     void drawBoard();
-    void drawPossibleMoves(Piece* piece);
+    void drawPossibleMoves(); // Appends a marker for every square in m_moveTargets to the overlay buffer, tinted red for losing captures.
+    void refreshMoveTargets(); // Recomputes m_moveTargets if the selection or the position changed since the last call.
     void drawPawnPromotion();
     
     // Menu/End Display Functions
@@ -50,9 +72,21 @@ public:
     void drawEndScreen(bool draw);
     
     // Load Assets
-    bool loadAssets();
+    void buildAtlas(); // Lays out every image in one GL texture and records where each goes. Needs a GL context.
+    void uploadScreenTextures(int screen); // Copies the images a screen draws into the atlas, the first time that screen is shown.
+    void queueSprite(int textureIndex, float right, float top, float width, float height); // Adds a quad for the image to the batch.
+    void flushSprites(); // Draws every queued quad in one call and empties the batch.
+    void buildBoardGeometry(); // Uploads the 64 squares into a static vertex buffer. Needs a GL context.
+    
+    // Computer opponent
+    bool computerToMove(); // Returns true if this is a game against the computer and it is the computer's turn.
+    void startComputerMove(); // Starts a background search if computerToMove(), or carries on the ponder search if it predicted the human's move.
+    void startPondering(Move expectedReply); // Searches the position after expectedReply while the human thinks.
+    SearchLimits computerLimits(bool ponder); // Time limits from the computer's clock
+    void pollSearch(); // Timer callback: reports progress and plays the move once the search has finished.
     
     void ppMenu(bool status);
+    void updateGameState(); // Moves to the end screen if the game is over (checkmate, stalemate or another draw).
     
     // Get Instance
     static Engine& getInstance()
@@ -63,21 +97,41 @@ public:
     
 private:
     Board* b;
-    unsigned char* texture_data[NUM_TEXTURES];
+    AssetStore m_assets; // Image pixels, released once they are in the atlas
     
     int m_gameState = 0;
     bool m_ppMenu = false;
-    
-    int pieceWidth;
-    int pieceHeight;
-    
-    int buttonHeight;
-    int buttonWidth;
-    
-    int bannerHeight;
-    int bannerWidth;
-    
-    int nrChannels;
+    bool m_vsComputer = false;
+    
+    Search m_search;
+    int m_reportedDepth = 0; // Deepest iteration already printed for the current search
+    int m_computerClockMs = 0;
+    int m_thinkStartTime = 0; // GLUT_ELAPSED_TIME when the computer's clock last started
+    
+    // Pondering
+    Move m_ponderMove = MOVE_NONE; // The human move being pondered on, or MOVE_NONE
+    Key m_ponderKey = 0; // Position after m_ponderMove
+    bool m_ponderHit = false; // The current search started as a ponder search that was hit
+    int m_ponderHits = 0;
+    int m_ponderMisses = 0;
+    int m_ponderSavedMs = 0; // Thinking time not needed thanks to ponder hits
+    
+    bool m_redrawPending = false; // A redisplay has been requested but not drawn yet
+    int m_lastFrameTime = 0; // GLUT_ELAPSED_TIME when the last frame was drawn
+    int m_framesDrawn = 0;
+    
+    unsigned int m_atlas = 0; // GL texture name of the atlas, filled by buildAtlas()
+    int m_atlasHeight = 0;
+    int m_atlasX[NUM_TEXTURES]; // Texel position of each image in the atlas
+    int m_atlasY[NUM_TEXTURES];
+    bool m_screenUploaded[NUM_SCREENS] = {};
+    Sprite m_sprites[NUM_TEXTURES];
+    std::vector<float> m_spriteBatch; // x, y, u, v per vertex, four vertices per quad
+    
+    unsigned int m_boardVBO = 0; // Static squares
+    int m_boardVertexCount = 0;
+    unsigned int m_overlayVBO = 0; // Selection highlight and move markers, refilled each time they are drawn
+    std::vector<ColorVertex> m_overlay;
     
     int selectedR = -1;
     int selectedC = -1;
@@ -85,6 +139,12 @@ private:
     
     int lastSelR = -1;
     int lastSelC = -1;
+    
+    // Legal destinations of the selected piece, cached for the position and square they were computed for
+    Bitboard m_moveTargets = 0;
+    Bitboard m_losingCaptures = 0; // Targets where the capture loses material once the exchange plays out
+    int m_targetsFrom = NO_SQUARE;
+    Key m_targetsKey = 0;
 };
 
 inline Engine& Eng()
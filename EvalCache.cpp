@@ -0,0 +1,29 @@
+//
+//  EvalCache.cpp
+//  Chess
+//
+
+#include "EvalCache.h"
+using namespace std;
+
+EvalCache::EvalCache()
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= size_t(EVAL_CACHE_SIZE_KB) * 1024)
+    {
+        count *= 2;
+    }
+    m_entries = vector<Entry>(count);
+    m_mask = count - 1;
+    clear();
+}
+
+void EvalCache::clear()
+{
+    // An empty slot holds check 1 and data 0, which only matches key 1
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        m_entries[i].data.store(0, memory_order_relaxed);
+        m_entries[i].check.store(1, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,93 @@
+//
+//  EvalCache.h
+//  Chess
+//
+
+#ifndef EVALCACHE_INCLUDED
+#define EVALCACHE_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Zobrist.h"
+
+const int EVAL_CACHE_SIZE_KB = 2048; // Independent of TT_SIZE_MB
+
+// Static evaluations by position key. Lossy: a slot just holds the last position stored in it.
+// Each entry stores the key XORed with its data, so a slot torn by two threads writing at once
+// fails the check instead of returning another position's score, and no lock is needed.
+class EvalCache
+{
+public:
+    EvalCache();
+
+    void prefetch(Key key) const; // Starts loading key's slot, so a probe soon after doesn't wait on memory.
+    bool probe(Key key, int& score); // Returns true and sets score if key is cached.
+    void store(Key key, int score);
+    void clear();
+    void clearStats();
+    uint64_t probes() const;
+    uint64_t hits() const;
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    std::vector<Entry> m_entries;
+    size_t m_mask = 0;
+    uint64_t m_probes = 0; // Counted by the thread that owns the cache
+    uint64_t m_hits = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE PROBES
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline void EvalCache::prefetch(Key key) const
+{
+    __builtin_prefetch(&m_entries[key & m_mask]);
+}
+
+inline bool EvalCache::probe(Key key, int& score)
+{
+    Entry& e = m_entries[key & m_mask];
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    m_probes++;
+    if ((e.check.load(std::memory_order_relaxed) ^ data) != key)
+    {
+        return false;
+    }
+    m_hits++;
+    score = int(int16_t(data & 0xFFFF));
+    return true;
+}
+
+inline void EvalCache::store(Key key, int score)
+{
+    Entry& e = m_entries[key & m_mask];
+    uint64_t data = uint16_t(int16_t(score));
+    e.data.store(data, std::memory_order_relaxed);
+    e.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+inline void EvalCache::clearStats()
+{
+    m_probes = 0;
+    m_hits = 0;
+}
+
+inline uint64_t EvalCache::probes() const
+{
+    return m_probes;
+}
+
+inline uint64_t EvalCache::hits() const
+{
+    return m_hits;
+}
+
+#endif /* EVALCACHE_INCLUDED */
@@ -0,0 +1,402 @@
+//
+//  Evaluate.cpp
+//  Chess
+//
+
+#include "Evaluate.h"
+#include "Board.h"
+#include "Material.h"
+#include "Pawns.h"
+#include <algorithm>
+#include <mutex>
+using namespace std;
+
+int PSQ_MG[12][64];
+int PSQ_EG[12][64];
+
+// Endgame bonus for a passed pawn with no piece of either color on its path, by relative rank
+const int FREE_PASSER_EG[8] = {0, 0, 0, 5, 10, 20, 40, 0};
+
+// Mobility: bonus per safe square a piece attacks, counted from a typical number of squares for
+// its type, so an average piece scores about zero. Indexed by piece type.
+const int MOBILITY_MG[NUM_PIECE_TYPES] = {0, 1, 2, 5, 4, 0};
+const int MOBILITY_EG[NUM_PIECE_TYPES] = {0, 2, 4, 5, 4, 0};
+const int MOBILITY_BASE[NUM_PIECE_TYPES] = {0, 14, 7, 6, 4, 0};
+
+// King safety: each piece attacking the squares around the enemy king adds its weight to the
+// attack units, as does each attacked square. The penalty grows with the square of the units,
+// and only counts once two pieces join in.
+const int KING_ATTACK_WEIGHT[NUM_PIECE_TYPES] = {0, 5, 3, 2, 2, 0};
+const int KING_DANGER_MAX = 500;
+
+const int THREAT_BY_PAWN_MG = 30; // Per piece attacked by an enemy pawn
+const int THREAT_BY_PAWN_EG = 20;
+const int HANGING_MG = 15;        // Per piece or pawn attacked and not defended at all
+const int HANGING_EG = 10;
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Piece-square tables
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Bonuses for a white piece, laid out as the board is seen from white's side: the first row is
+// rank 8, the last is rank 1. Black uses the same tables mirrored vertically.
+static const int MG_TABLE[NUM_PIECE_TYPES][64] = {
+    { // King
+        -65,  23,  16, -15, -56, -34,   2,  13,
+         29,  -1, -20,  -7,  -8,  -4, -38, -29,
+         -9,  24,   2, -16, -20,   6,  22, -22,
+        -17, -20, -12, -27, -30, -25, -14, -36,
+        -49,  -1, -27, -39, -46, -44, -33, -51,
+        -14, -14, -22, -46, -44, -30, -15, -27,
+          1,   7,  -8, -64, -43, -16,   9,   8,
+        -15,  36,  12, -54,   8, -28,  24,  14,
+    },
+    { // Queen
+        -28,   0,  29,  12,  59,  44,  43,  45,
+        -24, -39,  -5,   1, -16,  57,  28,  54,
+        -13, -17,   7,   8,  29,  56,  47,  57,
+        -27, -27, -16, -16,  -1,  17,  -2,   1,
+         -9, -26,  -9, -10,  -2,  -4,   3,  -3,
+        -14,   2, -11,  -2,  -5,   2,  14,   5,
+        -35,  -8,  11,   2,   8,  15,  -3,   1,
+         -1, -18,  -9,  10, -15, -25, -31, -50,
+    },
+    { // Rook
+         32,  42,  32,  51,  63,   9,  31,  43,
+         27,  32,  58,  62,  80,  67,  26,  44,
+         -5,  19,  26,  36,  17,  45,  61,  16,
+        -24, -11,   7,  26,  24,  35,  -8, -20,
+        -36, -26, -12,  -1,   9,  -7,   6, -23,
+        -45, -25, -16, -17,   3,   0,  -5, -33,
+        -44, -16, -20,  -9,  -1,  11,  -6, -71,
+        -19, -13,   1,  17,  16,   7, -37, -26,
+    },
+    { // Bishop
+        -29,   4, -82, -37, -25, -42,   7,  -8,
+        -26,  16, -18, -13,  30,  59,  18, -47,
+        -16,  37,  43,  40,  35,  50,  37,  -2,
+         -4,   5,  19,  50,  37,  37,   7,  -2,
+         -6,  13,  13,  26,  34,  12,  10,   4,
+          0,  15,  15,  15,  14,  27,  18,  10,
+          4,  15,  16,   0,   7,  21,  33,   1,
+        -33,  -3, -14, -21, -13, -12, -39, -21,
+    },
+    { // Knight
+       -167, -89, -34, -49,  61, -97, -15,-107,
+        -73, -41,  72,  36,  23,  62,   7, -17,
+        -47,  60,  37,  65,  84, 129,  73,  44,
+         -9,  17,  19,  53,  37,  69,  18,  22,
+        -13,   4,  16,  13,  28,  19,  21,  -8,
+        -23,  -9,  12,  10,  19,  17,  25, -16,
+        -29, -53, -12,  -3,  -1,  18, -14, -19,
+       -105, -21, -58, -33, -17, -28, -19, -23,
+    },
+    { // Pawn
+          0,   0,   0,   0,   0,   0,   0,   0,
+         98, 134,  61,  95,  68, 126,  34, -11,
+         -6,   7,  26,  31,  65,  56,  25, -20,
+        -14,  13,   6,  21,  23,  12,  17, -23,
+        -27,  -2,  -5,  12,  17,   6,  10, -25,
+        -26,  -4,  -4, -10,   3,   3,  33, -12,
+        -35,  -1, -20, -23, -15,  24,  38, -22,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    },
+};
+
+static const int EG_TABLE[NUM_PIECE_TYPES][64] = {
+    { // King
+        -74, -35, -18, -18, -11,  15,   4, -17,
+        -12,  17,  14,  17,  17,  38,  23,  11,
+         10,  17,  23,  15,  20,  45,  44,  13,
+         -8,  22,  24,  27,  26,  33,  26,   3,
+        -18,  -4,  21,  24,  27,  23,   9, -11,
+        -19,  -3,  11,  21,  23,  16,   7,  -9,
+        -27, -11,   4,  13,  14,   4,  -5, -17,
+        -53, -34, -21, -11, -28, -14, -24, -43,
+    },
+    { // Queen
+         -9,  22,  22,  27,  27,  19,  10,  20,
+        -17,  20,  32,  41,  58,  25,  30,   0,
+        -20,   6,   9,  49,  47,  35,  19,   9,
+          3,  22,  24,  45,  57,  40,  57,  36,
+        -18,  28,  19,  47,  31,  34,  39,  23,
+        -16, -27,  15,   6,   9,  17,  10,   5,
+        -22, -23, -30, -16, -16, -23, -36, -32,
+        -33, -28, -22, -43,  -5, -32, -20, -41,
+    },
+    { // Rook
+         13,  10,  18,  15,  12,  12,   8,   5,
+         11,  13,  13,  11,  -3,   3,   8,   3,
+          7,   7,   7,   5,   4,  -3,  -5,  -3,
+          4,   3,  13,   1,   2,   1,  -1,   2,
+          3,   5,   8,   4,  -5,  -6,  -8, -11,
+         -4,   0,  -5,  -1,  -7, -12,  -8, -16,
+         -6,  -6,   0,   2,  -9,  -9, -11,  -3,
+         -9,   2,   3,  -1,  -5, -13,   4, -20,
+    },
+    { // Bishop
+        -14, -21, -11,  -8,  -7,  -9, -17, -24,
+         -8,  -4,   7, -12,  -3, -13,  -4, -14,
+          2,  -8,   0,  -1,  -2,   6,   0,   4,
+         -3,   9,  12,   9,  14,  10,   3,   2,
+         -6,   3,  13,  19,   7,  10,  -3,  -9,
+        -12,  -3,   8,  10,  13,   3,  -7, -15,
+        -14, -18,  -7,  -1,   4,  -9, -15, -27,
+        -23,  -9, -23,  -5,  -9, -16,  -5, -17,
+    },
+    { // Knight
+        -58, -38, -13, -28, -31, -27, -63, -99,
+        -25,  -8, -25,  -2,  -9, -25, -24, -52,
+        -24, -20,  10,   9,  -1,  -9, -19, -41,
+        -17,   3,  22,  22,  22,  11,   8, -18,
+        -18,  -6,  16,  25,  16,  17,   4, -18,
+        -23,  -3,  -1,  15,  10,  -3, -20, -22,
+        -42, -20, -10,  -5,  -2, -20, -23, -44,
+        -29, -51, -23, -15, -22, -18, -50, -64,
+    },
+    { // Pawn
+          0,   0,   0,   0,   0,   0,   0,   0,
+        178, 173, 158, 134, 147, 132, 165, 187,
+         94, 100,  85,  67,  56,  53,  82,  84,
+         32,  24,  13,   5,  -2,   4,  17,  17,
+         13,   9,  -3,  -7,  -7,  -8,   3,  -1,
+          4,   7,  -6,   1,   0,  -5,  -1,  -8,
+         13,   8,   8,  10,  13,   0,   2,  -7,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    },
+};
+
+static void fillPSQ()
+{
+    for (int type = 0; type < NUM_PIECE_TYPES; type++)
+    {
+        for (int sq = 0; sq < 64; sq++)
+        {
+            // Squares count up from a1, the tables down from a8, so white flips the rank and black reads it as is
+            PSQ_MG[type * 2 + WHITE][sq] = PIECE_VALUE_MG[type] + MG_TABLE[type][sq ^ 56];
+            PSQ_EG[type * 2 + WHITE][sq] = PIECE_VALUE_EG[type] + EG_TABLE[type][sq ^ 56];
+            PSQ_MG[type * 2 + BLACK][sq] = -(PIECE_VALUE_MG[type] + MG_TABLE[type][sq]);
+            PSQ_EG[type * 2 + BLACK][sq] = -(PIECE_VALUE_EG[type] + EG_TABLE[type][sq]);
+        }
+    }
+}
+
+void initPSQ()
+{
+    static once_flag once;
+    call_once(once, fillPSQ);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// evaluate
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Attack maps, built once per evaluation and shared by the mobility, king safety and threat terms
+struct AttackInfo
+{
+    Bitboard byType[2][NUM_PIECE_TYPES]; // Squares attacked by each color's pieces of each type
+    Bitboard all[2];
+    Bitboard kingZone[2];   // The king's square and the squares around it
+    int kingAttackers[2];   // Enemy pieces attacking this color's king zone
+    int kingAttackUnits[2];
+};
+
+template<int Us>
+static void initAttacks(const Board& b, AttackInfo& ai)
+{
+    Bitboard pawns = b.piecesBB(PAWN_ID + Us);
+    int ksq = b.kingSquare(Us);
+    ai.byType[Us][PAWN_ID / 2] = shift<Side<Us>::UpEast>(pawns) | shift<Side<Us>::UpWest>(pawns);
+    ai.byType[Us][KING_ID / 2] = KING_ATTACKS[ksq];
+    ai.all[Us] = ai.byType[Us][PAWN_ID / 2] | ai.byType[Us][KING_ID / 2];
+    ai.kingZone[Us] = KING_ATTACKS[ksq] | squareBB(ksq);
+    ai.kingAttackers[Us] = 0;
+    ai.kingAttackUnits[Us] = 0;
+}
+
+// Attacks of Us's knights, bishops, rooks and queens: mobility for Us, and attack units against Them's king
+template<int Us>
+static void evaluatePieces(const Board& b, AttackInfo& ai, int& mg, int& eg, EvalTrace* trace)
+{
+    const int Them = Side<Us>::Them;
+    const int sign = Us == WHITE ? 1 : -1;
+    Bitboard occupied = b.occupied();
+    Bitboard safe = ~b.colorBB(Us) & ~ai.byType[Them][PAWN_ID / 2];
+
+    for (int type = QUEEN_ID; type <= KNIGHT_ID; type += 2)
+    {
+        Bitboard pieces = b.piecesBB(type + Us);
+        ai.byType[Us][type / 2] = 0;
+        while (pieces)
+        {
+            int sq = popLsb(pieces);
+            Bitboard attacks = type == KNIGHT_ID ? KNIGHT_ATTACKS[sq]
+                             : type == BISHOP_ID ? bishopAttacks(sq, occupied)
+                             : type == ROOK_ID ? rookAttacks(sq, occupied)
+                             : queenAttacks(sq, occupied);
+            ai.byType[Us][type / 2] |= attacks;
+
+            int mobility = popcount(attacks & safe) - MOBILITY_BASE[type / 2];
+            mg += sign * mobility * MOBILITY_MG[type / 2];
+            eg += sign * mobility * MOBILITY_EG[type / 2];
+            if (trace)
+            {
+                trace->count.mobility[type / 2] += sign * mobility;
+            }
+
+            Bitboard zoneAttacks = attacks & ai.kingZone[Them];
+            if (zoneAttacks)
+            {
+                ai.kingAttackers[Them]++;
+                ai.kingAttackUnits[Them] += KING_ATTACK_WEIGHT[type / 2] + popcount(zoneAttacks);
+            }
+        }
+        ai.all[Us] |= ai.byType[Us][type / 2];
+    }
+}
+
+// King danger, pawn threats and undefended pieces of Us, read off the finished attack maps
+template<int Us>
+static void evaluateThreats(const Board& b, const AttackInfo& ai, int& mg, int& eg, EvalTrace* trace)
+{
+    const int Them = Side<Us>::Them;
+    const int sign = Us == WHITE ? 1 : -1;
+
+    if (ai.kingAttackers[Us] >= 2 && b.pieceCount(QUEEN_ID + Them) > 0)
+    {
+        int units = ai.kingAttackUnits[Us];
+        int danger = min(units * units / 2, KING_DANGER_MAX);
+        mg -= sign * danger;
+        if (trace)
+        {
+            trace->fixedMg -= sign * danger;
+        }
+    }
+
+    Bitboard pieces = b.colorBB(Us) & ~b.typeBB(PAWN_ID) & ~b.typeBB(KING_ID);
+    int threatened = popcount(pieces & ai.byType[Them][PAWN_ID / 2]);
+    mg -= sign * threatened * THREAT_BY_PAWN_MG;
+    eg -= sign * threatened * THREAT_BY_PAWN_EG;
+
+    int hanging = popcount(b.colorBB(Us) & ~b.typeBB(KING_ID) & ai.all[Them] & ~ai.all[Us]);
+    mg -= sign * hanging * HANGING_MG;
+    eg -= sign * hanging * HANGING_EG;
+    if (trace)
+    {
+        trace->count.threatByPawn -= sign * threatened;
+        trace->count.hanging -= sign * hanging;
+    }
+}
+
+// Material and piece-square counts, which evaluate() otherwise takes from Board's running sums
+static void tracePieces(const Board& b, EvalTrace& trace)
+{
+    for (int pieceID = 0; pieceID < 12; pieceID++)
+    {
+        int sign = (pieceID & 1) == WHITE ? 1 : -1;
+        Bitboard pieces = b.piecesBB(pieceID);
+        while (pieces)
+        {
+            int sq = popLsb(pieces);
+            trace.count.material[pieceID / 2] += sign;
+            trace.count.psq[pieceID / 2][(pieceID & 1) == WHITE ? sq ^ 56 : sq] += sign;
+        }
+    }
+}
+
+int evaluate(const Board& b, PawnTable& pawns, MaterialTable& material, EvalTrace* trace)
+{
+    if (trace)
+    {
+        *trace = EvalTrace();
+    }
+
+    // Known endings have their own evaluator, which replaces all the generic terms
+    MaterialEntry* me = material.probe(b);
+    if (me->endgame != nullptr)
+    {
+        if (trace)
+        {
+            trace->endgame = true;
+        }
+        int score = me->endgame->evaluate(b, me->endgame->strongSide);
+        return b.sideToMove() == me->endgame->strongSide ? score : -score;
+    }
+
+    // Board keeps the PSQ sums and phase up to date on every move, and the pawn terms almost always come from the hash
+    PawnEntry* pe = pawns.probe(b);
+    int mg = b.psqMg() + pe->mg + pe->shield(b, WHITE) - pe->shield(b, BLACK) + me->imbalanceMg;
+    int eg = b.psqEg() + pe->eg + me->imbalanceEg;
+    if (trace)
+    {
+        tracePieces(b, *trace);
+        tracePawns(b, *trace);
+        traceMaterial(b, *trace);
+    }
+
+    for (int color = WHITE; color <= BLACK; color++)
+    {
+        Bitboard passed = pe->passed[color];
+        while (passed)
+        {
+            int sq = popLsb(passed);
+            Bitboard path = RAYS[color == WHITE ? RAY_NORTH : RAY_SOUTH][sq];
+            if (!(path & b.occupied()))
+            {
+                int rank = color == WHITE ? sq >> 3 : 7 - (sq >> 3);
+                eg += color == WHITE ? FREE_PASSER_EG[rank] : -FREE_PASSER_EG[rank];
+                if (trace)
+                {
+                    trace->count.freePasser[rank] += color == WHITE ? 1 : -1;
+                }
+            }
+        }
+    }
+
+    // Pawn and king attacks first, since mobility only counts squares enemy pawns don't guard
+    AttackInfo ai;
+    initAttacks<WHITE>(b, ai);
+    initAttacks<BLACK>(b, ai);
+    evaluatePieces<WHITE>(b, ai, mg, eg, trace);
+    evaluatePieces<BLACK>(b, ai, mg, eg, trace);
+    evaluateThreats<WHITE>(b, ai, mg, eg, trace);
+    evaluateThreats<BLACK>(b, ai, mg, eg, trace);
+
+    int scale = me->scale[eg > 0 ? WHITE : BLACK];
+    eg = eg * scale / SCALE_NORMAL;
+
+    int phase = min(b.phase(), PHASE_MAX);
+    if (trace)
+    {
+        trace->scale = scale;
+        trace->phase = phase;
+    }
+    int score = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+    return b.sideToMove() == WHITE ? score : -score;
+}
+
+void evalWeights(EvalTerms& mg, EvalTerms& eg)
+{
+    for (int type = 0; type < NUM_PIECE_TYPES; type++)
+    {
+        mg.material[type] = PIECE_VALUE_MG[type];
+        eg.material[type] = PIECE_VALUE_EG[type];
+        for (int sq = 0; sq < 64; sq++)
+        {
+            mg.psq[type][sq] = MG_TABLE[type][sq];
+            eg.psq[type][sq] = EG_TABLE[type][sq];
+        }
+        mg.mobility[type] = MOBILITY_MG[type];
+        eg.mobility[type] = MOBILITY_EG[type];
+    }
+    for (int rank = 0; rank < 8; rank++)
+    {
+        mg.freePasser[rank] = 0;
+        eg.freePasser[rank] = FREE_PASSER_EG[rank];
+    }
+    mg.threatByPawn = THREAT_BY_PAWN_MG;
+    eg.threatByPawn = THREAT_BY_PAWN_EG;
+    mg.hanging = HANGING_MG;
+    eg.hanging = HANGING_EG;
+    pawnWeights(mg, eg);
+    materialWeights(mg, eg);
+}
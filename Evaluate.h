@@ -0,0 +1,77 @@
+//
+//  Evaluate.h
+//  Chess
+//
+
+#ifndef EVALUATE_INCLUDED
+#define EVALUATE_INCLUDED
+
+#include "globals.h"
+class Board;
+class PawnTable;
+class MaterialTable;
+
+// Centipawn values indexed by piece type (pieceID / 2). The king is never traded, so it has none.
+// Used for move ordering; the evaluation itself uses the tapered values below.
+const int PIECE_VALUE[NUM_PIECE_TYPES] = {0, 900, 500, 330, 320, 100};
+
+// Middlegame and endgame material, indexed by piece type
+const int PIECE_VALUE_MG[NUM_PIECE_TYPES] = {0, 1025, 477, 365, 337, 82};
+const int PIECE_VALUE_EG[NUM_PIECE_TYPES] = {0, 936, 512, 297, 281, 94};
+
+// Each piece left on the board moves the game phase towards the middlegame by its weight.
+// PHASE_MAX is the starting position; promotions can push the sum past it, so it is clamped.
+const int PHASE_WEIGHT[NUM_PIECE_TYPES] = {0, 4, 2, 1, 1, 0};
+const int PHASE_MAX = 24;
+
+// Material plus piece-square bonus of a piece on a square, indexed by pieceID, then square.
+// Signed from white's point of view, so black pieces have negative entries and Board can just add them up.
+extern int PSQ_MG[12][64];
+extern int PSQ_EG[12][64];
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// TUNING
+////////////////////////////////////////////////////////////////////////////////////////////////
+// One slot per weight the evaluation adds up linearly, so that the tuner can fit them. The same
+// layout holds the weights themselves (see evalWeights) or, in an EvalTrace, how many times each
+// weight counted in one position, white's uses minus black's.
+struct EvalTerms
+{
+    int material[NUM_PIECE_TYPES];
+    int psq[NUM_PIECE_TYPES][64]; // Laid out like the tables in Evaluate.cpp: rank 8 first, as seen from the piece's own side
+    int doubled;
+    int isolated;
+    int backward;
+    int passed[8];      // By relative rank
+    int freePasser[8];  // Endgame only
+    int shieldOneAhead; // Middlegame only
+    int shieldTwoAhead;
+    int shieldMissing;
+    int mobility[NUM_PIECE_TYPES];
+    int threatByPawn;
+    int hanging;
+    int bishopPair;
+    int knightPerPawn;  // Same weight in both phases
+    int rookPerPawn;
+};
+
+const int NUM_EVAL_TERMS = sizeof(EvalTerms) / sizeof(int);
+
+// What evaluate() saw in one position, in terms of the weights. The score is rebuilt as
+// mg = sum(count * mg weight) + fixedMg, eg likewise, then eg * scale / SCALE_NORMAL and the taper by phase.
+struct EvalTrace
+{
+    EvalTerms count;
+    int fixedMg;  // King danger, which isn't linear in its weights, already in centipawns
+    int fixedEg;
+    int scale;    // Endgame scale for the side the endgame score favors
+    int phase;    // Clamped to PHASE_MAX
+    bool endgame; // A specialized endgame evaluator gave the score, and the rest is empty
+};
+
+void initPSQ(); // Fills the PSQ tables. Safe to call more than once, from any thread.
+int evaluate(const Board& b, PawnTable& pawns, MaterialTable& material, EvalTrace* trace = nullptr); // Static score of the position in centipawns, from the side to move's point of view. Also fills trace, if given, for the tuner.
+void evalWeights(EvalTerms& mg, EvalTerms& eg); // The weights evaluate() uses, in the trace layout
+
+#endif /* EVALUATE_INCLUDED */
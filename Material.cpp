@@ -0,0 +1,130 @@
+//
+//  Material.cpp
+//  Chess
+//
+
+#include "Material.h"
+#include "Board.h"
+#include "Evaluate.h"
+using namespace std;
+
+const int BISHOP_PAIR_MG = 30, BISHOP_PAIR_EG = 50;
+const int KNIGHT_PER_PAWN = 6;  // Knights gain with every own pawn above five, as the position stays closed
+const int ROOK_PER_PAWN = -12;  // Rooks lose, as files stay shut
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Imbalance and scaling
+////////////////////////////////////////////////////////////////////////////////////////////////
+static int nonPawnMaterial(const Board& b, int color)
+{
+    int npm = 0;
+    for (int type = QUEEN_ID; type < PAWN_ID; type += 2)
+    {
+        npm += b.pieceCount(type + color) * PIECE_VALUE_MG[type / 2];
+    }
+    return npm;
+}
+
+static void computeImbalance(const Board& b, int color, MaterialEntry& e, EvalTrace* trace)
+{
+    int sign = color == WHITE ? 1 : -1;
+    int extraPawns = b.pieceCount(PAWN_ID + color) - 5;
+    int mg = 0;
+    int eg = 0;
+    if (b.pieceCount(BISHOP_ID + color) >= 2)
+    {
+        mg += BISHOP_PAIR_MG;
+        eg += BISHOP_PAIR_EG;
+    }
+    int pawnAdjustment = extraPawns * (b.pieceCount(KNIGHT_ID + color) * KNIGHT_PER_PAWN + b.pieceCount(ROOK_ID + color) * ROOK_PER_PAWN);
+    mg += pawnAdjustment;
+    eg += pawnAdjustment;
+    e.imbalanceMg += short(sign * mg);
+    e.imbalanceEg += short(sign * eg);
+    if (trace)
+    {
+        trace->count.bishopPair += sign * (b.pieceCount(BISHOP_ID + color) >= 2);
+        trace->count.knightPerPawn += sign * extraPawns * b.pieceCount(KNIGHT_ID + color);
+        trace->count.rookPerPawn += sign * extraPawns * b.pieceCount(ROOK_ID + color);
+    }
+}
+
+// Without pawns, a lead of a minor piece or less rarely wins
+static int computeScale(const Board& b, int color)
+{
+    int us = nonPawnMaterial(b, color);
+    int them = nonPawnMaterial(b, color ^ 1);
+    if (b.pieceCount(PAWN_ID + color) > 0)
+    {
+        return SCALE_NORMAL;
+    }
+    if (us == 2 * PIECE_VALUE_MG[KNIGHT_ID / 2] && b.pieceCount(KNIGHT_ID + color) == 2 && them == 0 && b.pieceCount(PAWN_ID + (color ^ 1)) == 0)
+    {
+        return 0; // KNNK can't be forced
+    }
+    if (us - them <= PIECE_VALUE_MG[BISHOP_ID / 2])
+    {
+        return us < PIECE_VALUE_MG[ROOK_ID / 2] ? 0 : them <= PIECE_VALUE_MG[BISHOP_ID / 2] ? 4 : 14;
+    }
+    return SCALE_NORMAL;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// MaterialTable
+////////////////////////////////////////////////////////////////////////////////////////////////
+MaterialTable::MaterialTable()
+{
+    initEndgames();
+
+    size_t count = 1;
+    while (count * 2 * sizeof(MaterialEntry) <= size_t(MATERIAL_TABLE_SIZE_KB) * 1024)
+    {
+        count *= 2;
+    }
+    m_entries.resize(count);
+    m_mask = count - 1;
+
+    // Empty slots get a key no real material combination is expected to have
+    for (size_t i = 0; i < count; i++)
+    {
+        m_entries[i].key = ~Key(0);
+    }
+}
+
+MaterialEntry* MaterialTable::probe(const Board& b)
+{
+    Key key = b.materialKey();
+    MaterialEntry& e = m_entries[key & m_mask];
+    if (e.key == key)
+    {
+        return &e;
+    }
+
+    e.key = key;
+    e.endgame = findEndgame(key);
+    e.imbalanceMg = 0;
+    e.imbalanceEg = 0;
+    computeImbalance(b, WHITE, e, nullptr);
+    computeImbalance(b, BLACK, e, nullptr);
+    e.scale[WHITE] = (unsigned char)computeScale(b, WHITE);
+    e.scale[BLACK] = (unsigned char)computeScale(b, BLACK);
+    return &e;
+}
+
+void traceMaterial(const Board& b, EvalTrace& trace)
+{
+    MaterialEntry e;
+    e.imbalanceMg = 0;
+    e.imbalanceEg = 0;
+    computeImbalance(b, WHITE, e, &trace);
+    computeImbalance(b, BLACK, e, &trace);
+}
+
+void materialWeights(EvalTerms& mg, EvalTerms& eg)
+{
+    mg.bishopPair = BISHOP_PAIR_MG;
+    eg.bishopPair = BISHOP_PAIR_EG;
+    mg.knightPerPawn = eg.knightPerPawn = KNIGHT_PER_PAWN;
+    mg.rookPerPawn = eg.rookPerPawn = ROOK_PER_PAWN;
+}
@@ -0,0 +1,47 @@
+//
+//  Material.h
+//  Chess
+//
+
+#ifndef MATERIAL_INCLUDED
+#define MATERIAL_INCLUDED
+
+#include <cstddef>
+#include <vector>
+#include "Endgame.h"
+#include "Zobrist.h"
+
+class Board;
+struct EvalTerms;
+struct EvalTrace;
+
+const int MATERIAL_TABLE_SIZE_KB = 256;
+const int SCALE_NORMAL = 64; // Scale factor that leaves the endgame score as it is
+
+// Everything the evaluation needs that depends only on how many of each piece are left
+struct MaterialEntry
+{
+    Key key;
+    const Endgame* endgame;  // Specialized evaluator for this material, or nullptr
+    short imbalanceMg;       // Piece combination terms from white's point of view
+    short imbalanceEg;
+    unsigned char scale[2];  // Multiplies the endgame score, out of SCALE_NORMAL, when that color is ahead
+};
+
+// Material hash table, indexed by the low bits of the material key. Only the thread that owns it uses it.
+class MaterialTable
+{
+public:
+    MaterialTable();
+
+    MaterialEntry* probe(const Board& b); // Returns the entry for b's material, filling it in first on a miss.
+
+private:
+    std::vector<MaterialEntry> m_entries;
+    size_t m_mask = 0;
+};
+
+void traceMaterial(const Board& b, EvalTrace& trace); // Adds the imbalance terms of b to trace, without the table
+void materialWeights(EvalTerms& mg, EvalTerms& eg);  // Fills in the imbalance weights
+
+#endif /* MATERIAL_INCLUDED */
@@ -0,0 +1,73 @@
+//
+//  Move.h
+//  Chess
+//
+
+#ifndef MOVE_INCLUDED
+#define MOVE_INCLUDED
+
+#include <string>
+#include "globals.h"
+
+// A move packed into 16 bits:
+//      bits 0-5    from square
+//      bits 6-11   to square
+//      bits 12-13  promotion piece (0 = queen, 1 = rook, 2 = bishop, 3 = knight)
+//      bits 14-15  move type
+// Castling is encoded as the king's two-square move.
+typedef unsigned short Move;
+
+const Move MOVE_NONE = 0;
+
+const int MOVE_NORMAL = 0;
+const int MOVE_PROMOTION = 1 << 14;
+const int MOVE_EN_PASSANT = 2 << 14;
+const int MOVE_CASTLING = 3 << 14;
+
+const int MAX_MOVES = 256; // Upper bound on the number of moves in any position
+
+inline Move makeMove(int from, int to, int type = MOVE_NORMAL)
+{
+    return Move(from | (to << 6) | type);
+}
+
+inline Move makePromotion(int from, int to, int promotionType) // promotionType is QUEEN_ID, ROOK_ID, BISHOP_ID or KNIGHT_ID
+{
+    return Move(from | (to << 6) | ((promotionType / 2 - 1) << 12) | MOVE_PROMOTION);
+}
+
+inline int moveFrom(Move m)
+{
+    return m & 0x3F;
+}
+
+inline int moveTo(Move m)
+{
+    return (m >> 6) & 0x3F;
+}
+
+inline int moveType(Move m)
+{
+    return m & (3 << 14);
+}
+
+inline int promotionType(Move m) // Returns QUEEN_ID, ROOK_ID, BISHOP_ID or KNIGHT_ID
+{
+    return (((m >> 12) & 3) + 1) * 2;
+}
+
+inline std::string moveToString(Move m) // Coordinate notation, e.g. "e2e4" or "e7e8q"
+{
+    std::string s;
+    s += char('a' + (moveFrom(m) & 7));
+    s += char('1' + (moveFrom(m) >> 3));
+    s += char('a' + (moveTo(m) & 7));
+    s += char('1' + (moveTo(m) >> 3));
+    if (moveType(m) == MOVE_PROMOTION)
+    {
+        s += "qrbn"[promotionType(m) / 2 - 1];
+    }
+    return s;
+}
+
+#endif /* MOVE_INCLUDED */
@@ -0,0 +1,191 @@
+//
+//  MoveGen.cpp
+//  Chess
+//
+
+#include "MoveGen.h"
+#include "Board.h"
+#include "Bitboard.h"
+using namespace std;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// PAWNS
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Emits one move per set bit of targets, each coming from the square Delta behind it.
+template<int Delta>
+static inline Move* emitPawnMoves(Bitboard targets, Move* list)
+{
+    while (targets)
+    {
+        int to = popLsb(targets);
+        *list++ = makeMove(to - Delta, to);
+    }
+    return list;
+}
+
+template<int Delta>
+static inline Move* emitPromotions(Bitboard targets, Move* list)
+{
+    while (targets)
+    {
+        int to = popLsb(targets);
+        *list++ = makePromotion(to - Delta, to, QUEEN_ID);
+        *list++ = makePromotion(to - Delta, to, KNIGHT_ID);
+        *list++ = makePromotion(to - Delta, to, ROOK_ID);
+        *list++ = makePromotion(to - Delta, to, BISHOP_ID);
+    }
+    return list;
+}
+
+// All pawn pushes and captures are whole-board shifts, so there is no per-pawn branching on direction or rank.
+template<int Us>
+static Move* generatePawnMoves(const Board& b, Move* list)
+{
+    typedef Side<Us> S;
+    
+    Bitboard pawns = b.piecesBB(PAWN_ID + Us);
+    Bitboard empty = ~b.occupied();
+    Bitboard enemies = b.colorBB(S::Them);
+    Bitboard promoting = pawns & S::PrePromotionRank;
+    Bitboard others = pawns & ~S::PrePromotionRank;
+    
+    // Pushes
+    Bitboard push1 = shift<S::Up>(others) & empty;
+    Bitboard push2 = shift<S::Up>(push1 & S::DoublePushRank) & empty;
+    list = emitPawnMoves<S::Up>(push1, list);
+    list = emitPawnMoves<2 * S::Up>(push2, list);
+    
+    // Captures
+    list = emitPawnMoves<S::UpEast>(shift<S::UpEast>(others) & enemies, list);
+    list = emitPawnMoves<S::UpWest>(shift<S::UpWest>(others) & enemies, list);
+    
+    // Promotions
+    if (promoting)
+    {
+        list = emitPromotions<S::Up>(shift<S::Up>(promoting) & empty, list);
+        list = emitPromotions<S::UpEast>(shift<S::UpEast>(promoting) & enemies, list);
+        list = emitPromotions<S::UpWest>(shift<S::UpWest>(promoting) & enemies, list);
+    }
+    
+    // En passant
+    if (b.epSquare() != NO_SQUARE)
+    {
+        Bitboard capturers = others & PAWN_ATTACKS[S::Them][b.epSquare()];
+        while (capturers)
+        {
+            *list++ = makeMove(popLsb(capturers), b.epSquare(), MOVE_EN_PASSANT);
+        }
+    }
+    return list;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// PIECES
+////////////////////////////////////////////////////////////////////////////////////////////////
+template<int PieceType>
+static inline Bitboard pieceAttacks(int sq, Bitboard occupied)
+{
+    return PieceType == KNIGHT_ID ? KNIGHT_ATTACKS[sq]
+         : PieceType == BISHOP_ID ? bishopAttacks(sq, occupied)
+         : PieceType == ROOK_ID   ? rookAttacks(sq, occupied)
+         : PieceType == QUEEN_ID  ? queenAttacks(sq, occupied)
+         : KING_ATTACKS[sq];
+}
+
+template<int Us, int PieceType>
+static inline Move* generatePieceMoves(const Board& b, Move* list)
+{
+    Bitboard pieces = b.piecesBB(PieceType + Us);
+    Bitboard targets = ~b.colorBB(Us);
+    while (pieces)
+    {
+        int from = popLsb(pieces);
+        Bitboard attacks = pieceAttacks<PieceType>(from, b.occupied()) & targets;
+        while (attacks)
+        {
+            *list++ = makeMove(from, popLsb(attacks));
+        }
+    }
+    return list;
+}
+
+template<int Us>
+static Move* generateCastling(const Board& b, Move* list)
+{
+    typedef Side<Us> S;
+    const int king = S::KingStart;
+    
+    if ((b.castlingRights() & S::KingSideRights) && !(b.occupied() & S::KingSidePath) &&
+        !b.squareAttacked<S::Them>(king, b.occupied()) &&
+        !b.squareAttacked<S::Them>(king + 1, b.occupied()) &&
+        !b.squareAttacked<S::Them>(king + 2, b.occupied()))
+    {
+        *list++ = makeMove(king, king + 2, MOVE_CASTLING);
+    }
+    if ((b.castlingRights() & S::QueenSideRights) && !(b.occupied() & S::QueenSidePath) &&
+        !b.squareAttacked<S::Them>(king, b.occupied()) &&
+        !b.squareAttacked<S::Them>(king - 1, b.occupied()) &&
+        !b.squareAttacked<S::Them>(king - 2, b.occupied()))
+    {
+        *list++ = makeMove(king, king - 2, MOVE_CASTLING);
+    }
+    return list;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// GENERATORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+template<int Us>
+Move* generatePseudoLegalMoves(const Board& b, Move* list)
+{
+    list = generatePawnMoves<Us>(b, list);
+    list = generatePieceMoves<Us, KNIGHT_ID>(b, list);
+    list = generatePieceMoves<Us, BISHOP_ID>(b, list);
+    list = generatePieceMoves<Us, ROOK_ID>(b, list);
+    list = generatePieceMoves<Us, QUEEN_ID>(b, list);
+    list = generatePieceMoves<Us, KING_ID>(b, list);
+    if (b.castlingRights())
+    {
+        list = generateCastling<Us>(b, list);
+    }
+    return list;
+}
+
+template Move* generatePseudoLegalMoves<WHITE>(const Board& b, Move* list);
+template Move* generatePseudoLegalMoves<BLACK>(const Board& b, Move* list);
+
+Move* generatePseudoLegalMoves(const Board& b, Move* list)
+{
+    return b.sideToMove() == WHITE ? generatePseudoLegalMoves<WHITE>(b, list) : generatePseudoLegalMoves<BLACK>(b, list);
+}
+
+bool hasLegalMove(const Board& b)
+{
+    Move list[MAX_MOVES];
+    Move* end = generatePseudoLegalMoves(b, list);
+    for (Move* m = list; m != end; m++)
+    {
+        if (b.legal(*m))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Move* generateLegalMoves(const Board& b, Move* list)
+{
+    Move* end = generatePseudoLegalMoves(b, list);
+    Move* last = list;
+    for (Move* m = list; m != end; m++)
+    {
+        if (b.legal(*m))
+        {
+            *last++ = *m;
+        }
+    }
+    return last;
+}
@@ -0,0 +1,19 @@
+//
+//  MoveGen.h
+//  Chess
+//
+
+#ifndef MOVEGEN_INCLUDED
+#define MOVEGEN_INCLUDED
+
+#include "Move.h"
+class Board;
+
+// Each generator writes moves for the side to move starting at list and returns one past the last move written.
+Move* generatePseudoLegalMoves(const Board& b, Move* list); // Moves that follow the rules except that they may leave the king in check
+Move* generateLegalMoves(const Board& b, Move* list);
+bool hasLegalMove(const Board& b); // Returns true as soon as one legal move is found.
+
+template<int Us> Move* generatePseudoLegalMoves(const Board& b, Move* list);
+
+#endif /* MOVEGEN_INCLUDED */
@@ -0,0 +1,408 @@
+//
+//  Nnue.cpp
+//  Chess
+//
+
+#include "Nnue.h"
+#include "Board.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NNUE_X86
+#include <immintrin.h>
+#endif
+using namespace std;
+
+struct Network
+{
+    const int16_t* ftBias;
+    const int16_t* ftWeights;
+    const int32_t* l1Bias;
+    const int8_t* l1Weights;
+    const int32_t* l2Bias;
+    const int8_t* l2Weights;
+    const int8_t* outWeights;
+    int32_t outBias;
+    void* map;
+    size_t mapSize;
+};
+
+// The hot loops, one set per instruction set. Picked once, when the network is loaded.
+struct Kernels
+{
+    const char* name;
+    void (*addRow)(int16_t* acc, const int16_t* row);
+    void (*subRow)(int16_t* acc, const int16_t* row);
+    int32_t (*dot)(const uint8_t* input, const int8_t* weights, int count); // count is a multiple of 32
+};
+
+static Network NET;
+static bool NET_LOADED = false;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Kernels
+////////////////////////////////////////////////////////////////////////////////////////////////
+static void addRowScalar(int16_t* acc, const int16_t* row)
+{
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        acc[i] += row[i];
+    }
+}
+
+static void subRowScalar(int16_t* acc, const int16_t* row)
+{
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        acc[i] -= row[i];
+    }
+}
+
+static int32_t dotScalar(const uint8_t* input, const int8_t* weights, int count)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += int32_t(input[i]) * weights[i];
+    }
+    return sum;
+}
+
+#ifdef NNUE_X86
+__attribute__((target("avx2")))
+static void addRowAVX2(int16_t* acc, const int16_t* row)
+{
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+        __m256i r = _mm256_loadu_si256((const __m256i*)(row + i));
+        _mm256_store_si256((__m256i*)(acc + i), _mm256_add_epi16(a, r));
+    }
+}
+
+__attribute__((target("avx2")))
+static void subRowAVX2(int16_t* acc, const int16_t* row)
+{
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i a = _mm256_load_si256((const __m256i*)(acc + i));
+        __m256i r = _mm256_loadu_si256((const __m256i*)(row + i));
+        _mm256_store_si256((__m256i*)(acc + i), _mm256_sub_epi16(a, r));
+    }
+}
+
+// Inputs are at most 127, so a pair of u8 x s8 products can't saturate maddubs
+__attribute__((target("avx2")))
+static int32_t dotAVX2(const uint8_t* input, const int8_t* weights, int count)
+{
+    __m256i sum = _mm256_setzero_si256();
+    __m256i ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < count; i += 32)
+    {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(input + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+
+__attribute__((target("sse4.1")))
+static void addRowSSE41(int16_t* acc, const int16_t* row)
+{
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i a = _mm_load_si128((const __m128i*)(acc + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(row + i));
+        _mm_store_si128((__m128i*)(acc + i), _mm_add_epi16(a, r));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void subRowSSE41(int16_t* acc, const int16_t* row)
+{
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i a = _mm_load_si128((const __m128i*)(acc + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(row + i));
+        _mm_store_si128((__m128i*)(acc + i), _mm_sub_epi16(a, r));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static int32_t dotSSE41(const uint8_t* input, const int8_t* weights, int count)
+{
+    __m128i sum = _mm_setzero_si128();
+    __m128i ones = _mm_set1_epi16(1);
+    for (int i = 0; i < count; i += 16)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i*)(input + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+static const Kernels SCALAR_KERNELS = {"scalar", addRowScalar, subRowScalar, dotScalar};
+static Kernels KERNELS = SCALAR_KERNELS;
+
+static void selectKernels()
+{
+#ifdef NNUE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        KERNELS = {"avx2", addRowAVX2, subRowAVX2, dotAVX2};
+        return;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        KERNELS = {"sse4.1", addRowSSE41, subRowSSE41, dotSSE41};
+        return;
+    }
+#endif
+    KERNELS = SCALAR_KERNELS;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Loading
+////////////////////////////////////////////////////////////////////////////////////////////////
+bool loadNetwork(const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    size_t expected = sizeof(NnueHeader)
+                    + sizeof(int16_t) * NNUE_HIDDEN + sizeof(int16_t) * size_t(NNUE_INPUTS) * NNUE_HIDDEN
+                    + sizeof(int32_t) * NNUE_L1 + 2 * NNUE_HIDDEN * NNUE_L1
+                    + sizeof(int32_t) * NNUE_L2 + NNUE_L1 * NNUE_L2
+                    + NNUE_L2 + sizeof(int32_t);
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) != expected)
+    {
+        cerr << path << " is not a network of the expected size" << endl;
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const unsigned char* p = static_cast<const unsigned char*>(map);
+    const NnueHeader* header = reinterpret_cast<const NnueHeader*>(p);
+    if (memcmp(header->magic, NNUE_MAGIC, 4) != 0 || header->version != NNUE_VERSION || header->inputs != uint32_t(NNUE_INPUTS)
+        || header->hidden != uint32_t(NNUE_HIDDEN) || header->l1 != uint32_t(NNUE_L1) || header->l2 != uint32_t(NNUE_L2))
+    {
+        cerr << path << " has the wrong network architecture" << endl;
+        munmap(map, expected);
+        return false;
+    }
+
+    if (NET_LOADED)
+    {
+        munmap(NET.map, NET.mapSize);
+    }
+    p += sizeof(NnueHeader);
+    NET.ftBias = reinterpret_cast<const int16_t*>(p);
+    p += sizeof(int16_t) * NNUE_HIDDEN;
+    NET.ftWeights = reinterpret_cast<const int16_t*>(p);
+    p += sizeof(int16_t) * size_t(NNUE_INPUTS) * NNUE_HIDDEN;
+    NET.l1Bias = reinterpret_cast<const int32_t*>(p);
+    p += sizeof(int32_t) * NNUE_L1;
+    NET.l1Weights = reinterpret_cast<const int8_t*>(p);
+    p += 2 * NNUE_HIDDEN * NNUE_L1;
+    NET.l2Bias = reinterpret_cast<const int32_t*>(p);
+    p += sizeof(int32_t) * NNUE_L2;
+    NET.l2Weights = reinterpret_cast<const int8_t*>(p);
+    p += NNUE_L1 * NNUE_L2;
+    NET.outWeights = reinterpret_cast<const int8_t*>(p);
+    p += NNUE_L2;
+    memcpy(&NET.outBias, p, sizeof(int32_t));
+    NET.map = map;
+    NET.mapSize = expected;
+
+    selectKernels();
+    NET_LOADED = true;
+    return true;
+}
+
+bool networkLoaded()
+{
+    return NET_LOADED;
+}
+
+const char* nnueKernels()
+{
+    return KERNELS.name;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Features
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Black sees the board flipped vertically, so both sides' features describe "our" pieces moving up
+static int orient(int perspective, int sq)
+{
+    return perspective == WHITE ? sq : sq ^ 56;
+}
+
+static int featureIndex(int perspective, int kingSq, int pieceID, int sq)
+{
+    int kind = (pieceID / 2 - 1) * 2 + ((pieceID & 1) != perspective);
+    return orient(perspective, kingSq) * 640 + kind * 64 + orient(perspective, sq);
+}
+
+static const int16_t* featureRow(int perspective, int kingSq, int pieceID, int sq)
+{
+    return NET.ftWeights + size_t(featureIndex(perspective, kingSq, pieceID, sq)) * NNUE_HIDDEN;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// NnueStack
+////////////////////////////////////////////////////////////////////////////////////////////////
+void NnueStack::refresh(const Board& b, int perspective, Accumulator& acc) const
+{
+    int16_t* values = acc.values[perspective];
+    memcpy(values, NET.ftBias, sizeof(int16_t) * NNUE_HIDDEN);
+    int kingSq = b.kingSquare(perspective);
+    for (int pieceID = W_QUEEN_ID; pieceID <= B_PAWN_ID; pieceID++)
+    {
+        Bitboard pieces = b.piecesBB(pieceID);
+        while (pieces)
+        {
+            KERNELS.addRow(values, featureRow(perspective, kingSq, pieceID, popLsb(pieces)));
+        }
+    }
+}
+
+void NnueStack::reset(const Board& b)
+{
+    m_top = 0;
+    refresh(b, WHITE, m_stack[0]);
+    refresh(b, BLACK, m_stack[0]);
+}
+
+void NnueStack::push(const Board& b)
+{
+    const Accumulator& prev = m_stack[m_top];
+    Accumulator& next = m_stack[++m_top];
+
+    // The pieces the move took off squares and put on squares. Kings aren't features.
+    Move m = b.lastMove();
+    int us = b.sideToMove() ^ 1;
+    int from = moveFrom(m);
+    int to = moveTo(m);
+    int removedID[2], removedSq[2], addedID[2], addedSq[2];
+    int removed = 0, added = 0;
+    bool kingMoved = false;
+
+    if (moveType(m) == MOVE_CASTLING)
+    {
+        bool kingSide = to > from;
+        kingMoved = true;
+        removedID[removed] = ROOK_ID + us;
+        removedSq[removed++] = kingSide ? from + 3 : from - 4;
+        addedID[added] = ROOK_ID + us;
+        addedSq[added++] = kingSide ? from + 1 : from - 1;
+    }
+    else
+    {
+        int movedID = b.pieceIDAt(to);
+        if (movedID == KING_ID + us)
+        {
+            kingMoved = true;
+        }
+        else
+        {
+            removedID[removed] = moveType(m) == MOVE_PROMOTION ? PAWN_ID + us : movedID;
+            removedSq[removed++] = from;
+            addedID[added] = movedID;
+            addedSq[added++] = to;
+        }
+        if (b.capturedPiece() >= 0)
+        {
+            removedID[removed] = b.capturedPiece();
+            removedSq[removed++] = moveType(m) == MOVE_EN_PASSANT ? makeSquare(squareRow(from), squareCol(to)) : to;
+        }
+    }
+
+    for (int perspective = WHITE; perspective <= BLACK; perspective++)
+    {
+        if (kingMoved && perspective == us)
+        {
+            refresh(b, perspective, next);
+            continue;
+        }
+        int16_t* values = next.values[perspective];
+        int kingSq = b.kingSquare(perspective);
+        memcpy(values, prev.values[perspective], sizeof(int16_t) * NNUE_HIDDEN);
+        for (int i = 0; i < removed; i++)
+        {
+            KERNELS.subRow(values, featureRow(perspective, kingSq, removedID[i], removedSq[i]));
+        }
+        for (int i = 0; i < added; i++)
+        {
+            KERNELS.addRow(values, featureRow(perspective, kingSq, addedID[i], addedSq[i]));
+        }
+    }
+}
+
+// int32 layer outputs back to the 0-127 range the next layer takes as input
+static void clippedRelu(const int32_t* in, uint8_t* out, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        out[i] = (uint8_t)min(max(in[i] >> NNUE_WEIGHT_SHIFT, 0), 127);
+    }
+}
+
+int NnueStack::evaluate(const Board& b) const
+{
+    const Accumulator& acc = m_stack[m_top];
+    int us = b.sideToMove();
+
+    alignas(32) uint8_t input[2 * NNUE_HIDDEN];
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        input[i] = (uint8_t)min(max(int(acc.values[us][i]), 0), 127);
+        input[NNUE_HIDDEN + i] = (uint8_t)min(max(int(acc.values[us ^ 1][i]), 0), 127);
+    }
+
+    int32_t l1[NNUE_L1];
+    alignas(32) uint8_t h1[NNUE_L1];
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        l1[o] = NET.l1Bias[o] + KERNELS.dot(input, NET.l1Weights + o * 2 * NNUE_HIDDEN, 2 * NNUE_HIDDEN);
+    }
+    clippedRelu(l1, h1, NNUE_L1);
+
+    int32_t l2[NNUE_L2];
+    alignas(32) uint8_t h2[NNUE_L2];
+    for (int o = 0; o < NNUE_L2; o++)
+    {
+        l2[o] = NET.l2Bias[o] + KERNELS.dot(h1, NET.l2Weights + o * NNUE_L1, NNUE_L1);
+    }
+    clippedRelu(l2, h2, NNUE_L2);
+
+    int32_t out = NET.outBias + KERNELS.dot(h2, NET.outWeights, NNUE_L2);
+    return out / NNUE_OUTPUT_SCALE;
+}
@@ -0,0 +1,90 @@
+//
+//  Nnue.h
+//  Chess
+//
+
+#ifndef NNUE_INCLUDED
+#define NNUE_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+class Board;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// NETWORK FORMAT
+////////////////////////////////////////////////////////////////////////////////////////////////
+// A HalfKP network: each side sees every non-king piece relative to its own king square, mirrored
+// so that both sides look up the board. The two 256-wide accumulators, side to move first, feed
+// two 32-wide clipped ReLU layers and a single output.
+//
+// network.nnue is an NnueHeader followed by the little-endian arrays below, in this order:
+//      int16 ftBias[NNUE_HIDDEN]
+//      int16 ftWeights[NNUE_INPUTS][NNUE_HIDDEN]
+//      int32 l1Bias[NNUE_L1]          int8 l1Weights[NNUE_L1][2 * NNUE_HIDDEN]
+//      int32 l2Bias[NNUE_L2]          int8 l2Weights[NNUE_L2][NNUE_L1]
+//      int8  outWeights[NNUE_L2]      int32 outBias
+const char NNUE_MAGIC[4] = {'C', 'H', 'N', 'N'};
+const uint32_t NNUE_VERSION = 1;
+const char* const NNUE_FILE = "network.nnue"; // Looked for next to the binary
+
+const int NNUE_INPUTS = 64 * 10 * 64; // King square, then piece kind (5 types x ours/theirs), then square
+const int NNUE_HIDDEN = 256;
+const int NNUE_L1 = 32;
+const int NNUE_L2 = 32;
+const int NNUE_WEIGHT_SHIFT = 6;  // Dense layer weights are fixed point with 6 fractional bits
+const int NNUE_OUTPUT_SCALE = 16; // Output units per centipawn
+const int NNUE_STACK_SIZE = 128;  // Plies of accumulators kept; more than the search ever reaches
+
+struct NnueHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t inputs;    // NNUE_INPUTS
+    uint32_t hidden;    // NNUE_HIDDEN
+    uint32_t l1;        // NNUE_L1
+    uint32_t l2;        // NNUE_L2
+    uint32_t reserved[10]; // Pads the header to 64 bytes, so the arrays after it stay aligned
+};
+
+bool loadNetwork(const std::string& path); // Maps the weights. Returns false, leaving the classical evaluation in use, if the file is missing or malformed.
+bool networkLoaded();
+const char* nnueKernels(); // "avx2", "sse4.1" or "scalar": the code path picked for this CPU when the network was loaded
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// ACCUMULATORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+struct Accumulator
+{
+    alignas(32) int16_t values[2][NNUE_HIDDEN]; // Indexed by perspective
+};
+
+// Accumulators along the current search path, one per ply. Each move only adds and removes the
+// rows of the pieces it touched; a side's accumulator is rebuilt only when its own king moves.
+class NnueStack
+{
+public:
+    void reset(const Board& b); // Builds the root accumulator from scratch.
+    void push(const Board& b);  // b has just played a move: derives its accumulator from the previous one.
+    void pop();                 // The move was taken back.
+    int evaluate(const Board& b) const; // Centipawns from the side to move's point of view
+
+private:
+    void refresh(const Board& b, int perspective, Accumulator& acc) const;
+
+    Accumulator m_stack[NNUE_STACK_SIZE];
+    int m_top = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ACCESSORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline void NnueStack::pop()
+{
+    m_top--;
+}
+
+#endif /* NNUE_INCLUDED */
@@ -0,0 +1,203 @@
+//
+//  PackedPosition.cpp
+//  Chess
+//
+
+#include "PackedPosition.h"
+#include "Board.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Encoding
+////////////////////////////////////////////////////////////////////////////////////////////////
+PackedPosition packPosition(const Board& b, int whiteScore, int result)
+{
+    PackedPosition p;
+    memset(&p, 0, sizeof(p));
+    p.occupied = b.occupied();
+    Bitboard occupied = p.occupied;
+    for (int i = 0; occupied; i++)
+    {
+        int sq = popLsb(occupied);
+        p.pieces[i / 2] |= uint8_t(b.pieceIDAt(sq) << (4 * (i & 1)));
+    }
+    p.flags = uint8_t(b.sideToMove() | b.castlingRights() << 1);
+    p.epSquare = b.epSquare() == NO_SQUARE ? PACKED_NO_EP : uint8_t(b.epSquare());
+    p.rule50 = uint8_t(min(b.rule50(), 255));
+    p.result = uint8_t(result);
+    p.score = int16_t(max(-32000, min(whiteScore, 32000)));
+    p.fullMoves = uint16_t(min(b.totalMoves() / 2 + 1, 65535));
+    return p;
+}
+
+bool unpackPosition(const PackedPosition& p, Board& b)
+{
+    if (popcount(p.occupied) > 2 * MAX_PIECES)
+    {
+        return false;
+    }
+    int pieceAt[64];
+    fill(pieceAt, pieceAt + 64, -1);
+    Bitboard occupied = p.occupied;
+    for (int i = 0; occupied; i++)
+    {
+        int sq = popLsb(occupied);
+        pieceAt[sq] = (p.pieces[i / 2] >> (4 * (i & 1))) & 15;
+    }
+    int epSquare = p.epSquare == PACKED_NO_EP ? NO_SQUARE : p.epSquare;
+    return b.setPosition(pieceAt, p.flags & 1, (p.flags >> 1) & ALL_CASTLING, epSquare, p.rule50, p.fullMoves);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// PackedWriter
+////////////////////////////////////////////////////////////////////////////////////////////////
+static bool validHeader(const PackedFileHeader& header)
+{
+    return memcmp(header.magic, PACKED_MAGIC, 4) == 0 && header.version == PACKED_VERSION && header.recordSize == sizeof(PackedPosition);
+}
+
+bool isPackedFile(const string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    PackedFileHeader header;
+    bool packed = fread(&header, sizeof(header), 1, file) == 1 && validHeader(header);
+    fclose(file);
+    return packed;
+}
+
+PackedWriter::~PackedWriter()
+{
+    close();
+}
+
+bool PackedWriter::open(const string& path)
+{
+    close();
+
+    // An existing file must already be a dataset; an empty or missing one gets the header first
+    struct stat info;
+    bool exists = stat(path.c_str(), &info) == 0 && info.st_size > 0;
+    if (exists && !isPackedFile(path))
+    {
+        cerr << path << " is not a packed position file" << endl;
+        return false;
+    }
+
+    // A writer that crashed may have left part of a record, which would shift every record appended after it
+    if (exists)
+    {
+        size_t records = (size_t(info.st_size) - sizeof(PackedFileHeader)) / sizeof(PackedPosition);
+        off_t whole = off_t(sizeof(PackedFileHeader) + records * sizeof(PackedPosition));
+        if (whole != info.st_size && truncate(path.c_str(), whole) != 0)
+        {
+            cerr << "can't drop the partial record at the end of " << path << endl;
+            return false;
+        }
+    }
+    m_file = fopen(path.c_str(), "ab");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+    if (!exists)
+    {
+        PackedFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, PACKED_MAGIC, 4);
+        header.version = PACKED_VERSION;
+        header.recordSize = sizeof(PackedPosition);
+        fwrite(&header, sizeof(header), 1, m_file);
+    }
+    return true;
+}
+
+void PackedWriter::write(const PackedPosition* records, size_t count)
+{
+    fwrite(records, sizeof(PackedPosition), count, m_file);
+}
+
+void PackedWriter::flush()
+{
+    fflush(m_file);
+}
+
+void PackedWriter::close()
+{
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// PackedReader
+////////////////////////////////////////////////////////////////////////////////////////////////
+PackedReader::~PackedReader()
+{
+    close();
+}
+
+bool PackedReader::open(const string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "can't open " << path << endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(PackedFileHeader))
+    {
+        cerr << path << " is not a packed position file" << endl;
+        ::close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+    if (!validHeader(*static_cast<const PackedFileHeader*>(map)))
+    {
+        cerr << path << " is not a packed position file" << endl;
+        munmap(map, size);
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    m_map = map;
+    m_mapSize = size;
+    m_records = reinterpret_cast<const PackedPosition*>(static_cast<const char*>(map) + sizeof(PackedFileHeader));
+    m_count = (size - sizeof(PackedFileHeader)) / sizeof(PackedPosition); // A record cut short by a crashed writer is left out
+    return true;
+}
+
+void PackedReader::close()
+{
+    if (m_map != nullptr)
+    {
+        munmap(m_map, m_mapSize);
+        m_map = nullptr;
+        m_mapSize = 0;
+        m_records = nullptr;
+        m_count = 0;
+    }
+}
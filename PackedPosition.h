@@ -0,0 +1,132 @@
+//
+//  PackedPosition.h
+//  Chess
+//
+
+#ifndef PACKEDPOSITION_INCLUDED
+#define PACKEDPOSITION_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class Board;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// FORMAT
+////////////////////////////////////////////////////////////////////////////////////////////////
+// A position in 32 bytes, for datasets. The occupied squares are listed by the bitboard, and the
+// pieces on them follow in square order, 4 bits each (the pieceID), low nibble first. A side never
+// holds more than MAX_PIECES, so 32 pieces always fit. Score and result ride along for training.
+// All fields are little-endian, and the struct is written to disk as it is laid out in memory.
+struct PackedPosition
+{
+    uint64_t occupied;
+    uint8_t pieces[16];
+    uint8_t flags;      // Bit 0 black to move, bits 1-4 castling rights
+    uint8_t epSquare;   // 0-63, or PACKED_NO_EP
+    uint8_t rule50;
+    uint8_t result;     // PACKED_BLACK_WON, PACKED_DRAW or PACKED_WHITE_WON
+    int16_t score;      // Search score in centipawns, from white's point of view
+    uint16_t fullMoves;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition is stored byte for byte");
+
+const uint8_t PACKED_NO_EP = 255;
+const uint8_t PACKED_BLACK_WON = 0;
+const uint8_t PACKED_DRAW = 1;
+const uint8_t PACKED_WHITE_WON = 2;
+
+// A dataset file is a PackedFileHeader followed by the records, so they stay 32-byte aligned when mapped
+const char PACKED_MAGIC[4] = {'C', 'H', 'P', 'S'};
+const uint32_t PACKED_VERSION = 1;
+
+struct PackedFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize; // sizeof(PackedPosition)
+    uint32_t reserved[5];
+};
+
+static_assert(sizeof(PackedFileHeader) == sizeof(PackedPosition), "the header takes one record's space");
+
+PackedPosition packPosition(const Board& b, int whiteScore = 0, int result = PACKED_DRAW);
+bool unpackPosition(const PackedPosition& p, Board& b); // Returns false, leaving b empty, if the record isn't a valid position.
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// STREAMS
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Appends records to a dataset file, through stdio's buffer. Not thread-safe.
+class PackedWriter
+{
+public:
+    PackedWriter() = default;
+    ~PackedWriter();
+    PackedWriter(const PackedWriter&) = delete;
+    PackedWriter& operator=(const PackedWriter&) = delete;
+
+    bool open(const std::string& path); // Creates the file, or appends to it if it already holds records, first dropping any partial record at the end. Returns false if it can't, or it isn't a dataset.
+    void write(const PackedPosition* records, size_t count);
+    void flush();
+    void close();
+
+private:
+    FILE* m_file = nullptr;
+};
+
+// Maps a whole dataset file read-only. Scanning it in order runs at memory bandwidth once the
+// pages are cached, and the kernel reads ahead while they aren't.
+class PackedReader
+{
+public:
+    PackedReader() = default;
+    ~PackedReader();
+    PackedReader(const PackedReader&) = delete;
+    PackedReader& operator=(const PackedReader&) = delete;
+
+    bool open(const std::string& path); // Returns false, with a message, if the file is missing or not a dataset.
+    void close();
+    size_t size() const; // Number of records
+    const PackedPosition* begin() const;
+    const PackedPosition* end() const;
+    const PackedPosition& operator[](size_t i) const;
+
+private:
+    void* m_map = nullptr;
+    size_t m_mapSize = 0;
+    const PackedPosition* m_records = nullptr;
+    size_t m_count = 0;
+};
+
+bool isPackedFile(const std::string& path); // Returns true if path starts with a dataset header
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ACCESSORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline size_t PackedReader::size() const
+{
+    return m_count;
+}
+
+inline const PackedPosition* PackedReader::begin() const
+{
+    return m_records;
+}
+
+inline const PackedPosition* PackedReader::end() const
+{
+    return m_records + m_count;
+}
+
+inline const PackedPosition& PackedReader::operator[](size_t i) const
+{
+    return m_records[i];
+}
+
+#endif /* PACKEDPOSITION_INCLUDED */
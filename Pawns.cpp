@@ -0,0 +1,230 @@
+//
+//  Pawns.cpp
+//  Chess
+//
+
+#include "Pawns.h"
+#include "Board.h"
+#include "Evaluate.h"
+#include <cstdlib>
+using namespace std;
+
+// Middlegame and endgame penalties, per pawn
+const int DOUBLED_MG = -10, DOUBLED_EG = -25;
+const int ISOLATED_MG = -5, ISOLATED_EG = -15;
+const int BACKWARD_MG = -9, BACKWARD_EG = -20;
+
+// Passed pawn bonus by rank, counted from the pawn's own side (index 1 is its starting rank)
+const int PASSED_MG[8] = {0, 0, 5, 10, 20, 35, 60, 0};
+const int PASSED_EG[8] = {0, 5, 10, 20, 35, 60, 100, 0};
+
+// Shield bonus for the nearest friendly pawn in front of the king on each of its three files,
+// by how many ranks it is ahead. A file with no pawn in front of the king is half open.
+const int SHIELD_ONE_AHEAD = 15;
+const int SHIELD_TWO_AHEAD = 8;
+const int SHIELD_MISSING = -12;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Masks
+////////////////////////////////////////////////////////////////////////////////////////////////
+static Bitboard fileBB(int sq)
+{
+    return FILE_A_BB << (sq & 7);
+}
+
+static Bitboard adjacentFilesBB(int sq)
+{
+    return shift<SHIFT_EAST>(fileBB(sq)) | shift<SHIFT_WEST>(fileBB(sq));
+}
+
+// Every square on the ranks in front of sq, as seen by color
+static Bitboard forwardRanksBB(int color, int sq)
+{
+    int rank = sq >> 3;
+    if (color == WHITE)
+    {
+        return rank == 7 ? 0 : ~0ULL << (8 * (rank + 1));
+    }
+    return rank == 0 ? 0 : ~0ULL >> (8 * (8 - rank));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Evaluation
+////////////////////////////////////////////////////////////////////////////////////////////////
+static void evaluatePawns(const Board& b, int color, PawnEntry& e, EvalTrace* trace)
+{
+    int sign = color == WHITE ? 1 : -1;
+    Bitboard ours = b.piecesBB(PAWN_ID + color);
+    Bitboard theirs = b.piecesBB(PAWN_ID + (color ^ 1));
+
+    e.passed[color] = 0;
+    Bitboard pawns = ours;
+    while (pawns)
+    {
+        int sq = popLsb(pawns);
+        int relativeRank = color == WHITE ? sq >> 3 : 7 - (sq >> 3);
+        Bitboard ahead = forwardRanksBB(color, sq);
+        Bitboard neighbours = ours & adjacentFilesBB(sq);
+        int mg = 0;
+        int eg = 0;
+
+        if (ours & ahead & fileBB(sq)) // The rear pawn of a doubled pair pays for it
+        {
+            mg += DOUBLED_MG;
+            eg += DOUBLED_EG;
+            if (trace)
+            {
+                trace->count.doubled += sign;
+            }
+        }
+        if (!neighbours)
+        {
+            mg += ISOLATED_MG;
+            eg += ISOLATED_EG;
+            if (trace)
+            {
+                trace->count.isolated += sign;
+            }
+        }
+        else if (!(neighbours & ~ahead)) // No neighbour level or behind to support it, and an enemy pawn guards its stop square
+        {
+            int stop = color == WHITE ? sq + 8 : sq - 8;
+            if (PAWN_ATTACKS[color][stop] & theirs)
+            {
+                mg += BACKWARD_MG;
+                eg += BACKWARD_EG;
+                if (trace)
+                {
+                    trace->count.backward += sign;
+                }
+            }
+        }
+        if (!(theirs & ahead & (fileBB(sq) | adjacentFilesBB(sq))))
+        {
+            e.passed[color] |= squareBB(sq);
+            mg += PASSED_MG[relativeRank];
+            eg += PASSED_EG[relativeRank];
+            if (trace)
+            {
+                trace->count.passed[relativeRank] += sign;
+            }
+        }
+
+        e.mg += sign * mg;
+        e.eg += sign * eg;
+    }
+}
+
+static int evaluateShield(const Board& b, int color, EvalTrace* trace)
+{
+    int ksq = b.kingSquare(color);
+    int sign = color == WHITE ? 1 : -1;
+    Bitboard ahead = b.piecesBB(PAWN_ID + color) & forwardRanksBB(color, ksq);
+    int file = ksq & 7;
+    int score = 0;
+    for (int f = max(file - 1, 0); f <= min(file + 1, 7); f++)
+    {
+        Bitboard onFile = ahead & (FILE_A_BB << f);
+        if (!onFile)
+        {
+            score += SHIELD_MISSING;
+            if (trace)
+            {
+                trace->count.shieldMissing += sign;
+            }
+            continue;
+        }
+        int nearest = color == WHITE ? lsb(onFile) : msb(onFile);
+        int distance = abs((nearest >> 3) - (ksq >> 3));
+        score += distance == 1 ? SHIELD_ONE_AHEAD : distance == 2 ? SHIELD_TWO_AHEAD : 0;
+        if (trace && distance <= 2)
+        {
+            (distance == 1 ? trace->count.shieldOneAhead : trace->count.shieldTwoAhead) += sign;
+        }
+    }
+    return score;
+}
+
+int PawnEntry::shield(const Board& b, int color)
+{
+    int ksq = b.kingSquare(color);
+    if (kingSquare[color] != ksq)
+    {
+        kingSquare[color] = ksq;
+        shieldMg[color] = evaluateShield(b, color, nullptr);
+    }
+    return shieldMg[color];
+}
+
+void tracePawns(const Board& b, EvalTrace& trace)
+{
+    PawnEntry e;
+    e.mg = 0;
+    e.eg = 0;
+    evaluatePawns(b, WHITE, e, &trace);
+    evaluatePawns(b, BLACK, e, &trace);
+    evaluateShield(b, WHITE, &trace);
+    evaluateShield(b, BLACK, &trace);
+}
+
+void pawnWeights(EvalTerms& mg, EvalTerms& eg)
+{
+    mg.doubled = DOUBLED_MG;
+    eg.doubled = DOUBLED_EG;
+    mg.isolated = ISOLATED_MG;
+    eg.isolated = ISOLATED_EG;
+    mg.backward = BACKWARD_MG;
+    eg.backward = BACKWARD_EG;
+    for (int rank = 0; rank < 8; rank++)
+    {
+        mg.passed[rank] = PASSED_MG[rank];
+        eg.passed[rank] = PASSED_EG[rank];
+    }
+    mg.shieldOneAhead = SHIELD_ONE_AHEAD;
+    mg.shieldTwoAhead = SHIELD_TWO_AHEAD;
+    mg.shieldMissing = SHIELD_MISSING;
+    eg.shieldOneAhead = eg.shieldTwoAhead = eg.shieldMissing = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// PawnTable
+////////////////////////////////////////////////////////////////////////////////////////////////
+PawnTable::PawnTable()
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(PawnEntry) <= size_t(PAWN_TABLE_SIZE_KB) * 1024)
+    {
+        count *= 2;
+    }
+    m_entries.resize(count);
+    m_mask = count - 1;
+
+    // Key 0 is a real position (no pawns), so empty slots need a key that won't match it
+    for (size_t i = 0; i < count; i++)
+    {
+        m_entries[i].key = ~Key(0);
+    }
+}
+
+PawnEntry* PawnTable::probe(const Board& b)
+{
+    Key key = b.pawnKey();
+    PawnEntry& e = m_entries[key & m_mask];
+    m_probes++;
+    if (e.key == key)
+    {
+        m_hits++;
+        return &e;
+    }
+
+    e.key = key;
+    e.mg = 0;
+    e.eg = 0;
+    evaluatePawns(b, WHITE, e, nullptr);
+    evaluatePawns(b, BLACK, e, nullptr);
+    e.kingSquare[WHITE] = e.kingSquare[BLACK] = NO_SQUARE;
+    return &e;
+}
@@ -0,0 +1,76 @@
+//
+//  Pawns.h
+//  Chess
+//
+
+#ifndef PAWNS_INCLUDED
+#define PAWNS_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Bitboard.h"
+#include "Zobrist.h"
+
+class Board;
+struct EvalTerms;
+struct EvalTrace;
+
+const int PAWN_TABLE_SIZE_KB = 1024;
+
+// Everything the evaluation needs that depends only on where the pawns stand
+struct PawnEntry
+{
+    Key key;
+    int mg;              // Doubled, isolated, backward and passed pawn terms, from white's point of view
+    int eg;
+    Bitboard passed[2];  // Passed pawns of each color
+    int kingSquare[2];   // King square shieldMg was computed for, or NO_SQUARE
+    int shieldMg[2];     // Pawn shield in front of each king, from that king's side's point of view
+
+    int shield(const Board& b, int color); // shieldMg for the king where it stands now, recomputed only if it has moved
+};
+
+// Pawn hash table, indexed by the low bits of the pawn key. The pawns change far less often than
+// the rest of the position, so almost every probe is a hit. Only the thread that owns it uses it.
+class PawnTable
+{
+public:
+    PawnTable();
+
+    PawnEntry* probe(const Board& b); // Returns the entry for b's pawns, evaluating them first on a miss.
+    void clearStats();
+    uint64_t probes() const;
+    uint64_t hits() const;
+
+private:
+    std::vector<PawnEntry> m_entries;
+    size_t m_mask = 0;
+    uint64_t m_probes = 0;
+    uint64_t m_hits = 0;
+};
+
+void tracePawns(const Board& b, EvalTrace& trace); // Adds the pawn structure and shield terms of b to trace, without the table
+void pawnWeights(EvalTerms& mg, EvalTerms& eg);    // Fills in the pawn and shield weights
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ACCESSORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline void PawnTable::clearStats()
+{
+    m_probes = 0;
+    m_hits = 0;
+}
+
+inline uint64_t PawnTable::probes() const
+{
+    return m_probes;
+}
+
+inline uint64_t PawnTable::hits() const
+{
+    return m_hits;
+}
+
+#endif /* PAWNS_INCLUDED */
@@ -10,119 +10,58 @@
 
 #include <iostream>
 #include <string>
-class Board;
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// PIECE BASE CLASS
+// PIECE
 ////////////////////////////////////////////////////////////////////////////////////////////////
+// Pieces are plain values stored in Board's fixed-size piece lists. The movement rules for
+// each piece type live in Board, which dispatches on pieceID().
 class Piece
 {
 public:
-    Piece(int row, int col, int color, int pieceID, Board* b);
-    virtual ~Piece();
-    
-    virtual bool mpAdherent(int proposedR, int proposedC) = 0; // Returns true if (proposedR, proposedC) adheres to the piece's movement pattern.
-    virtual bool notBlocked (int proposedR, int proposedC); // Returns true if the squares between the piece and (propsoedR, proposedC) are not occupied.
-    bool noPieceOverlap (int proposedR, int proposedC); // Returns true if there is not a piece of the same color at (proposedR, proposedC).
-    bool movePossible(int proposedR, int proposedC); // Returns true if the move to (proposedR, proposedC) is mpAdherent, notBlocked, noPieceOverlap, and kingSafe.
-    
+    Piece();
+    Piece(int row, int col, int color, int pieceID);
+
     // MUTATORS
     void updatePos(int proposedR, int proposedC);
-    void incrementMoves();
-    void setAliveStatus(bool alive);
-    
-    // ACCESSORS
+    void setPieceID(int pieceID); // Used when a pawn is promoted in place.
+
+    // ACCESSORS (defined inline below so Board's rule loops can inline them)
     int row() const;
     int col() const;
-    int numMoves() const;
-    bool alive() const;
     int color() const;
     int pieceID() const;
-    Board* board() const;
-    
+
 private:
-    int m_row;
-    int m_col;
-    int m_numMoves = 0;
-    bool m_alive = true;
-    int m_color;
-    int m_pieceID;
-    Board* m_board;
+    int m_row = 0;
+    int m_col = 0;
+    int m_color = 0;
+    int m_pieceID = 0;
 };
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
-// KING DERIVED CLASS
+// INLINE ACCESSORS
 ////////////////////////////////////////////////////////////////////////////////////////////////
-class King : public Piece
+inline int Piece::row() const
 {
-public:
-    King(int row, int col, int color, Board* b);
-    virtual bool mpAdherent(int proposedR, int proposedC);
-};
+    return m_row;
+}
 
-
-////////////////////////////////////////////////////////////////////////////////////////////////
-// QUEEN DERIVED CLASS
-////////////////////////////////////////////////////////////////////////////////////////////////
-class Queen : public Piece
+inline int Piece::col() const
 {
-public:
-    Queen(int row, int col, int color, Board* b);
-    virtual bool mpAdherent(int proposedR, int proposedC);
-};
-
+    return m_col;
+}
 
-////////////////////////////////////////////////////////////////////////////////////////////////
-// ROOK DERIVED CLASS
-////////////////////////////////////////////////////////////////////////////////////////////////
-class Rook : public Piece
+inline int Piece::color() const
 {
-public:
-    Rook(int row, int col, int color, Board* b);
-    virtual bool mpAdherent(int proposedR, int proposedC);
-};
-
+    return m_color;
+}
 
-////////////////////////////////////////////////////////////////////////////////////////////////
-// BISHOP DERIVED CLASS
-////////////////////////////////////////////////////////////////////////////////////////////////
-class Bishop : public Piece
+inline int Piece::pieceID() const
 {
-public:
-    Bishop(int row, int col, int color, Board* b);
-    virtual bool mpAdherent(int proposedR, int proposedC);
-};
-
-
-////////////////////////////////////////////////////////////////////////////////////////////////
-// KNIGHT DERIVED CLASS
-////////////////////////////////////////////////////////////////////////////////////////////////
-class Knight : public Piece
-{
-public:
-    Knight(int row, int col, int color, Board* b);
-    virtual bool mpAdherent(int proposedR, int proposedC);
-};
-
-
-////////////////////////////////////////////////////////////////////////////////////////////////
-// PAWN DERIVED CLASS
-////////////////////////////////////////////////////////////////////////////////////////////////
-class Pawn : public Piece
-{
-public:
-    Pawn(int row, int col, int color, Board* b);
-    void setPrevMoveNum(int moveNum); // The last time this piece was moved (with 0 corresponding to the first move)
-    int prevMoveNum() const;
-    virtual bool mpAdherent(int proposedR, int proposedC);
-    
-    // OVERRIDE
-    virtual bool notBlocked (int proposedR, int proposedC); // Pawn can also be blocked by pieces of the opposite color
-    
-private:
-    int m_prevMoveNum = -1;
-};
+    return m_pieceID;
+}
 
 #endif /* PIECE_INCLUDED */
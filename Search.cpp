@@ -0,0 +1,500 @@
+//
+//  Search.cpp
+//  Chess
+//
+
+#include "Search.h"
+#include "Evaluate.h"
+#include "MoveGen.h"
+#include "Nnue.h"
+#include <cstdlib>
+using namespace std;
+
+const uint64_t NODE_CHECK_MASK = 2047; // checkTime() runs every 2048 nodes, well under a millisecond at any realistic speed
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR/DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////
+Search::Search()
+ : m_stop(false), m_snapshot(0), m_publishedNodes(0), m_deadlineMs(0), m_pondering(false)
+{
+    m_tt.resize(TT_SIZE_MB);
+}
+
+Search::~Search()
+{
+    stop();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// CONTROL
+////////////////////////////////////////////////////////////////////////////////////////////////
+void Search::start(const Board& b, const SearchLimits& limits)
+{
+    stop();
+    prepare(b, limits);
+    m_thread = thread(&Search::run, this);
+}
+
+SearchInfo Search::think(const Board& b, const SearchLimits& limits)
+{
+    stop();
+    prepare(b, limits);
+    run();
+    return info();
+}
+
+void Search::clearHash()
+{
+    stop();
+    m_tt.clear();
+}
+
+void Search::prepare(const Board& b, const SearchLimits& limits)
+{
+    m_board = b;
+    m_limits = limits;
+    m_stop = false;
+    m_snapshot.store(0, memory_order_relaxed);
+    m_publishedNodes.store(0, memory_order_relaxed);
+    m_pawns.clearStats();
+    m_evalCache.clearStats();
+    m_time.init(limits.timeMs, limits.incrementMs, limits.movesToGo, limits.moveTimeMs);
+    m_pondering = limits.ponder;
+    m_deadlineMs.store(limits.ponder ? 0 : m_time.hardMs());
+    m_startTime = chrono::steady_clock::now();
+}
+
+void Search::ponderHit()
+{
+    // The time already spent pondering counts, so a long think by the opponent can mean an instant reply
+    m_deadlineMs.store(m_time.hardMs());
+    m_pondering = false;
+}
+
+int Search::softLimitMs() const
+{
+    return m_time.softMs();
+}
+
+double Search::pawnHitRate() const
+{
+    return m_pawns.probes() == 0 ? 0 : double(m_pawns.hits()) / m_pawns.probes();
+}
+
+double Search::evalCacheHitRate() const
+{
+    return m_evalCache.probes() == 0 ? 0 : double(m_evalCache.hits()) / m_evalCache.probes();
+}
+
+void Search::stop()
+{
+    m_stop = true;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+// The snapshot packs a whole SearchInfo except the node count into one word:
+//      bits 0-15   best move
+//      bits 16-23  depth
+//      bits 24-39  score + 32768
+//      bit 40      finished
+//      bits 41-56  ponder move
+void Search::publish(Move best, int depth, int score, bool finished)
+{
+    uint64_t packed = uint64_t(best)
+                    | uint64_t(depth & 0xFF) << 16
+                    | uint64_t((score + 32768) & 0xFFFF) << 24
+                    | uint64_t(finished) << 40
+                    | uint64_t(findPonderMove(best)) << 41;
+    m_publishedNodes.store(m_nodes, memory_order_relaxed);
+    m_snapshot.store(packed, memory_order_release);
+}
+
+SearchInfo Search::info() const
+{
+    uint64_t packed = m_snapshot.load(memory_order_acquire);
+    SearchInfo info;
+    info.bestMove = Move(packed & 0xFFFF);
+    info.depth = int((packed >> 16) & 0xFF);
+    info.score = int((packed >> 24) & 0xFFFF) - 32768;
+    info.finished = (packed >> 40) & 1;
+    info.ponderMove = Move((packed >> 41) & 0xFFFF);
+    info.nodes = m_publishedNodes.load(memory_order_relaxed);
+    return info;
+}
+
+Move Search::findPonderMove(Move best)
+{
+    if (best == MOVE_NONE)
+    {
+        return MOVE_NONE;
+    }
+    m_board.doMove(best);
+    const TTEntry* tte = m_tt.probe(m_board.key());
+    Move reply = MOVE_NONE;
+    if (tte != nullptr && tte->move != MOVE_NONE)
+    {
+        Move moves[MAX_MOVES];
+        Move* end = generateLegalMoves(m_board, moves);
+        for (Move* m = moves; m != end; m++)
+        {
+            if (*m == tte->move)
+            {
+                reply = *m;
+            }
+        }
+    }
+    m_board.undoMove();
+    return reply;
+}
+
+double Search::elapsedMs() const
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - m_startTime;
+    return elapsed.count();
+}
+
+void Search::checkTime()
+{
+    m_publishedNodes.store(m_nodes, memory_order_relaxed);
+    int deadline = m_deadlineMs.load(memory_order_relaxed);
+    if ((deadline > 0 && elapsedMs() >= deadline) || (m_limits.nodes > 0 && m_nodes >= m_limits.nodes))
+    {
+        m_stop = true;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// ITERATIVE DEEPENING
+////////////////////////////////////////////////////////////////////////////////////////////////
+void Search::run()
+{
+    m_nodes = 0;
+    m_rootBest = MOVE_NONE;
+    bool useNnue = networkLoaded();
+    if (useNnue != m_useNnue) // The cached scores came from the other evaluation
+    {
+        m_evalCache.clear();
+        m_useNnue = useNnue;
+    }
+    if (m_useNnue)
+    {
+        m_nnue.reset(m_board);
+    }
+
+    // Until the first iteration completes, any legal move is better than none
+    Move moves[MAX_MOVES];
+    int count = int(generateLegalMoves(m_board, moves) - moves);
+    Move best = count > 0 ? moves[0] : MOVE_NONE;
+    int bestScore = 0;
+    int completed = 0;
+
+    for (int depth = 1; depth < MAX_PLY && depth <= m_limits.depth && count > 1; depth++)
+    {
+        int score = alphaBeta(-SCORE_INFINITE, SCORE_INFINITE, depth, 0);
+        if (m_stop.load(memory_order_relaxed)) // An unfinished iteration is thrown away
+        {
+            break;
+        }
+        best = m_rootBest;
+        bestScore = score;
+        completed = depth;
+        publish(best, completed, bestScore, false);
+
+        // While pondering the clock isn't running, but the time manager still follows the iterations
+        if (m_time.iterationDone(elapsedMs(), best, score) && !m_pondering.load(memory_order_relaxed))
+        {
+            break;
+        }
+        // A forced mate that fits inside this depth won't change
+        if (abs(score) >= SCORE_MATE_IN_MAX_PLY && SCORE_MATE - abs(score) <= depth)
+        {
+            break;
+        }
+    }
+    publish(best, completed, bestScore, true);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// ALPHA-BETA
+////////////////////////////////////////////////////////////////////////////////////////////////
+void Search::makeMove(Move m)
+{
+    m_board.doMove(m);
+    m_evalCache.prefetch(m_board.key());
+    if (m_useNnue)
+    {
+        m_nnue.push(m_board);
+    }
+}
+
+void Search::unmakeMove()
+{
+    m_board.undoMove();
+    if (m_useNnue)
+    {
+        m_nnue.pop();
+    }
+}
+
+// The network when one is loaded, otherwise the hand-written evaluation. Either way the eval
+// cache is asked first, so transpositions and the positions quiescence keeps coming back to
+// skip the evaluation.
+int Search::staticEval()
+{
+    int score;
+    if (m_evalCache.probe(m_board.key(), score))
+    {
+        return score;
+    }
+    score = m_useNnue ? m_nnue.evaluate(m_board) : evaluate(m_board, m_pawns, m_material);
+    m_evalCache.store(m_board.key(), score);
+    return score;
+}
+
+// Mate scores are stored relative to the node, not the root, so they stay right when reached by another path
+static int scoreToTT(int score, int ply)
+{
+    return score >= SCORE_MATE_IN_MAX_PLY ? score + ply : score <= -SCORE_MATE_IN_MAX_PLY ? score - ply : score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+    return score >= SCORE_MATE_IN_MAX_PLY ? score - ply : score <= -SCORE_MATE_IN_MAX_PLY ? score + ply : score;
+}
+
+// Swaps the best-scored remaining move into slot i and returns it
+static Move pickMove(Move* moves, int* scores, int i, int count)
+{
+    int best = i;
+    for (int j = i + 1; j < count; j++)
+    {
+        if (scores[j] > scores[best])
+        {
+            best = j;
+        }
+    }
+    swap(moves[i], moves[best]);
+    swap(scores[i], scores[best]);
+    return moves[i];
+}
+
+void Search::scoreMoves(const Move* moves, int* scores, int count, Move ttMove) const
+{
+    for (int i = 0; i < count; i++)
+    {
+        Move m = moves[i];
+        scores[i] = 0;
+        if (m == ttMove)
+        {
+            scores[i] = 1 << 20;
+            continue;
+        }
+        if (m_board.isCapture(m))
+        {
+            // Captures that lose material in the exchange go after the quiet moves
+            int victim = moveType(m) == MOVE_EN_PASSANT ? PAWN_ID : m_board.pieceIDAt(moveTo(m));
+            int attacker = m_board.pieceIDAt(moveFrom(m));
+            scores[i] = (m_board.see(m, 0) ? 100000 : -100000) + 10 * PIECE_VALUE[victim / 2] - PIECE_VALUE[attacker / 2];
+        }
+        if (moveType(m) == MOVE_PROMOTION)
+        {
+            scores[i] += 50000 + PIECE_VALUE[promotionType(m) / 2];
+        }
+    }
+}
+
+int Search::alphaBeta(int alpha, int beta, int depth, int ply)
+{
+    if (ply > 0)
+    {
+        if (m_board.repetition(1) || m_board.fiftyMoveDraw() || m_board.insufficientMaterial())
+        {
+            return 0;
+        }
+        // No line through here can beat a mate that is already shorter
+        alpha = max(alpha, -SCORE_MATE + ply);
+        beta = min(beta, SCORE_MATE - ply - 1);
+        if (alpha >= beta)
+        {
+            return alpha;
+        }
+    }
+
+    bool inCheck = m_board.inCheck();
+    if (inCheck)
+    {
+        depth++;
+    }
+    if (depth <= 0)
+    {
+        return qsearch(alpha, beta, ply);
+    }
+    if (ply >= MAX_PLY - 1)
+    {
+        return staticEval();
+    }
+
+    if ((++m_nodes & NODE_CHECK_MASK) == 0 || m_nodes == m_limits.nodes)
+    {
+        checkTime();
+    }
+    if (m_stop.load(memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    Key key = m_board.key();
+    const TTEntry* tte = m_tt.probe(key);
+    Move ttMove = tte != nullptr ? tte->move : MOVE_NONE;
+    if (tte != nullptr && ply > 0 && tte->depth >= depth)
+    {
+        int ttScore = scoreFromTT(tte->score, ply);
+        if (tte->bound == BOUND_EXACT
+            || (tte->bound == BOUND_LOWER && ttScore >= beta)
+            || (tte->bound == BOUND_UPPER && ttScore <= alpha))
+        {
+            return ttScore;
+        }
+    }
+
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count = int(generateLegalMoves(m_board, moves) - moves);
+    if (count == 0)
+    {
+        return inCheck ? -SCORE_MATE + ply : 0;
+    }
+    scoreMoves(moves, scores, count, ttMove);
+
+    int oldAlpha = alpha;
+    int bestScore = -SCORE_INFINITE;
+    Move bestMove = MOVE_NONE;
+    for (int i = 0; i < count; i++)
+    {
+        Move m = pickMove(moves, scores, i, count);
+        makeMove(m);
+        int score = -alphaBeta(-beta, -alpha, depth - 1, ply + 1);
+        unmakeMove();
+        if (m_stop.load(memory_order_relaxed))
+        {
+            return 0;
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = m;
+            if (ply == 0)
+            {
+                m_rootBest = m;
+            }
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    int bound = bestScore >= beta ? BOUND_LOWER : bestScore > oldAlpha ? BOUND_EXACT : BOUND_UPPER;
+    m_tt.store(key, bound == BOUND_UPPER ? MOVE_NONE : bestMove, scoreToTT(bestScore, ply), depth, bound);
+    return bestScore;
+}
+
+// Resolves captures (and check evasions) until the position is quiet, so the static
+// evaluation is never taken in the middle of an exchange.
+int Search::qsearch(int alpha, int beta, int ply)
+{
+    if ((++m_nodes & NODE_CHECK_MASK) == 0 || m_nodes == m_limits.nodes)
+    {
+        checkTime();
+    }
+    if (m_stop.load(memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    bool inCheck = m_board.inCheck();
+    int bestScore = -SCORE_INFINITE;
+    if (!inCheck)
+    {
+        // Standing pat: the side to move can usually do at least as well as doing nothing
+        bestScore = staticEval();
+        if (bestScore >= beta || ply >= MAX_PLY - 1)
+        {
+            return bestScore;
+        }
+        alpha = max(alpha, bestScore);
+    }
+    else if (ply >= MAX_PLY - 1)
+    {
+        return staticEval();
+    }
+
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    Move* end = generatePseudoLegalMoves(m_board, moves);
+    int count = 0;
+    for (Move* m = moves; m != end; m++)
+    {
+        if (inCheck || m_board.isCapture(*m) || moveType(*m) == MOVE_PROMOTION)
+        {
+            moves[count++] = *m;
+        }
+    }
+    scoreMoves(moves, scores, count, MOVE_NONE);
+
+    bool anyLegal = false;
+    for (int i = 0; i < count; i++)
+    {
+        Move m = pickMove(moves, scores, i, count);
+        if (!m_board.legal(m))
+        {
+            continue;
+        }
+        anyLegal = true;
+
+        // Captures that lose material once the exchange plays out are very rarely worth resolving
+        if (!inCheck && !m_board.see(m, 0))
+        {
+            continue;
+        }
+        makeMove(m);
+        int score = -qsearch(-beta, -alpha, ply + 1);
+        unmakeMove();
+        if (m_stop.load(memory_order_relaxed))
+        {
+            return 0;
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (inCheck && !anyLegal)
+    {
+        return -SCORE_MATE + ply;
+    }
+    return bestScore;
+}
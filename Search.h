@@ -0,0 +1,112 @@
+//
+//  Search.h
+//  Chess
+//
+
+#ifndef SEARCH_INCLUDED
+#define SEARCH_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "Board.h"
+#include "EvalCache.h"
+#include "Material.h"
+#include "Move.h"
+#include "Nnue.h"
+#include "Pawns.h"
+#include "TT.h"
+#include "TimeManager.h"
+
+const int MAX_PLY = 64; // Deepest ply the search reaches, quiescence included
+const int SCORE_INFINITE = 32001;
+const int SCORE_MATE = 32000; // Mate at the root; mate n plies away scores SCORE_MATE - n
+const int SCORE_MATE_IN_MAX_PLY = SCORE_MATE - MAX_PLY;
+const int TT_SIZE_MB = 16;
+
+static_assert(MAX_PLY < NNUE_STACK_SIZE, "the NNUE stack needs an accumulator for every ply");
+static_assert(MAX_PLY + 100 < HISTORY_SIZE, "a search must be able to undo every ply and still see the fifty-move window behind its root");
+
+// With no time, moveTimeMs or nodes the search runs until depth or stop()
+struct SearchLimits
+{
+    int depth = MAX_PLY; // Deepest iteration to start
+    int moveTimeMs = 0;  // Fixed time for this move
+    int timeMs = 0;      // Clock of the side to move
+    int incrementMs = 0;
+    int movesToGo = 0;   // Moves until the next time control, 0 if the clock covers the whole game
+    uint64_t nodes = 0;  // Stop after this many nodes, 0 for no limit
+    bool ponder = false; // Searching on the opponent's time: the limits only start to apply at ponderHit()
+};
+
+// What the search has found so far. Published by the search thread as a single atomic word,
+// so the GUI can read it at any time without locking or waiting.
+struct SearchInfo
+{
+    Move bestMove = MOVE_NONE; // Best move of the deepest completed iteration
+    Move ponderMove = MOVE_NONE; // Expected reply to bestMove, if the TT has one
+    int depth = 0;             // Deepest completed iteration
+    int score = 0;             // From the side to move's point of view
+    bool finished = false;     // The search has stopped and bestMove is final
+    uint64_t nodes = 0;
+};
+
+// Iterative-deepening alpha-beta search on a worker thread. The thread works on its own copy
+// of the board, so the caller's board can keep being drawn and read while it thinks.
+class Search
+{
+public:
+    Search();
+    ~Search();
+    Search(const Search&) = delete;
+    Search& operator=(const Search&) = delete;
+
+    void start(const Board& b, const SearchLimits& limits); // Stops any running search, then searches a copy of b on the worker thread.
+    void stop(); // Asks the worker to finish and waits for it; info() then reports finished.
+    SearchInfo think(const Board& b, const SearchLimits& limits); // Searches b on the calling thread and returns the final info. For tools that run a search per thread of their own.
+    void clearHash(); // Forgets the TT entries of earlier searches, e.g. before a new game
+    void ponderHit(); // The opponent played the move being pondered: keep searching, now under the time limits counted from the start of pondering.
+    SearchInfo info() const; // Latest snapshot. Never blocks.
+    int softLimitMs() const; // Time the current search normally gets, 0 if unlimited
+    double pawnHitRate() const; // Share of pawn hash probes that hit during the last search. Only valid once it has stopped.
+    double evalCacheHitRate() const; // Same for the eval cache
+
+private:
+    void prepare(const Board& b, const SearchLimits& limits); // Resets the per-search state before run()
+    void run();
+    int alphaBeta(int alpha, int beta, int depth, int ply);
+    int qsearch(int alpha, int beta, int ply);
+    void makeMove(Move m); // doMove on the search board, keeping the NNUE accumulators in step
+    void unmakeMove();
+    int staticEval();
+    void scoreMoves(const Move* moves, int* scores, int count, Move ttMove) const; // Move ordering: TT move, then captures that don't lose material by MVV-LVA, then promotions, then the rest, then losing captures.
+    void checkTime(); // Called every few thousand nodes, and at the node limit: publishes the node count and sets m_stop once the time or nodes are up.
+    void publish(Move best, int depth, int score, bool finished);
+    Move findPonderMove(Move best); // The TT move after best, if it is legal
+    double elapsedMs() const;
+
+    Board m_board;
+    SearchLimits m_limits;
+    TimeManager m_time;
+    TranspositionTable m_tt;
+    MaterialTable m_material;
+    EvalCache m_evalCache;
+    PawnTable m_pawns; // Kept between searches; the pawn structure hardly changes from one move to the next
+    NnueStack m_nnue;
+    bool m_useNnue = false; // Set at the start of each search, if a network is loaded
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop;
+    std::atomic<uint64_t> m_snapshot; // Packed SearchInfo, see publish()
+    std::atomic<uint64_t> m_publishedNodes;
+    std::atomic<int> m_deadlineMs; // Hard limit in milliseconds after m_startTime, or 0 for none (set by ponderHit() while pondering)
+    std::atomic<bool> m_pondering;
+    std::chrono::steady_clock::time_point m_startTime; // Set before the worker starts
+
+    // Owned by the worker while it runs
+    uint64_t m_nodes = 0;
+    Move m_rootBest = MOVE_NONE;
+};
+
+#endif /* SEARCH_INCLUDED */
@@ -0,0 +1,23 @@
+//
+//  TT.cpp
+//  Chess
+//
+
+#include "TT.h"
+using namespace std;
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(TTEntry) <= megabytes * 1024 * 1024)
+    {
+        count *= 2;
+    }
+    m_entries.assign(count, TTEntry());
+    m_mask = count - 1;
+}
+
+void TranspositionTable::clear()
+{
+    m_entries.assign(m_entries.size(), TTEntry());
+}
@@ -0,0 +1,76 @@
+//
+//  TT.h
+//  Chess
+//
+
+#ifndef TT_INCLUDED
+#define TT_INCLUDED
+
+#include <cstddef>
+#include <vector>
+#include "Move.h"
+#include "Zobrist.h"
+
+const int BOUND_NONE = 0;
+const int BOUND_UPPER = 1; // The score is at most this (no move reached alpha)
+const int BOUND_LOWER = 2; // The score is at least this (a move reached beta)
+const int BOUND_EXACT = BOUND_UPPER | BOUND_LOWER;
+
+struct TTEntry
+{
+    Key key;
+    Move move;
+    short score;
+    signed char depth;
+    unsigned char bound;
+};
+
+// Transposition table: one entry per slot, indexed by the low bits of the key. Only the thread
+// that owns it reads or writes it.
+class TranspositionTable
+{
+public:
+    void resize(size_t megabytes); // Rounds down to a power of two number of entries and clears the table.
+    void clear();
+
+    const TTEntry* probe(Key key) const; // Returns the entry for key, or nullptr if the slot holds another position.
+    void store(Key key, Move move, int score, int depth, int bound);
+
+private:
+    std::vector<TTEntry> m_entries;
+    size_t m_mask = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE PROBES
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline const TTEntry* TranspositionTable::probe(Key key) const
+{
+    const TTEntry& e = m_entries[key & m_mask];
+    return e.key == key && e.bound != BOUND_NONE ? &e : nullptr;
+}
+
+inline void TranspositionTable::store(Key key, Move move, int score, int depth, int bound)
+{
+    TTEntry& e = m_entries[key & m_mask];
+    // A shallower result for the same position doesn't evict a deeper one, except to fill in its move
+    if (e.key == key && depth < e.depth)
+    {
+        if (e.move == MOVE_NONE)
+        {
+            e.move = move;
+        }
+        return;
+    }
+    if (move != MOVE_NONE || e.key != key) // Keep the old move when a fail-low for the same position has none
+    {
+        e.move = move;
+    }
+    e.key = key;
+    e.score = short(score);
+    e.depth = (signed char)depth;
+    e.bound = (unsigned char)bound;
+}
+
+#endif /* TT_INCLUDED */
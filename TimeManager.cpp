@@ -0,0 +1,68 @@
+//
+//  TimeManager.cpp
+//  Chess
+//
+
+#include "TimeManager.h"
+#include <algorithm>
+using namespace std;
+
+const int DEFAULT_MOVES_TO_GO = 40; // Assumed moves left in the game when the clock has no time control
+
+void TimeManager::init(int timeMs, int incrementMs, int movesToGo, int moveTimeMs)
+{
+    m_lastBest = MOVE_NONE;
+    m_lastScore = 0;
+    m_stableIterations = 0;
+
+    if (moveTimeMs > 0)
+    {
+        m_soft = moveTimeMs;
+        m_hard = moveTimeMs;
+        return;
+    }
+    if (timeMs <= 0)
+    {
+        m_soft = 0;
+        m_hard = 0;
+        return;
+    }
+
+    int available = max(1, timeMs - MOVE_OVERHEAD_MS);
+    int mtg = movesToGo > 0 ? min(movesToGo, DEFAULT_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+    // An even share of the clock plus most of the increment, but never so much that the next moves starve
+    int share = available / mtg + incrementMs * 3 / 4;
+    double softCap = mtg == 1 ? 0.8 : 0.5;
+    m_soft = max(1, min(share, int(available * softCap)));
+
+    // The hard limit leaves room for a few unstable iterations, but never risks the flag
+    m_hard = max(m_soft, min(m_soft * 4, int(available * 0.8)));
+}
+
+bool TimeManager::iterationDone(double elapsedMs, Move best, int score)
+{
+    m_stableIterations = best == m_lastBest ? m_stableIterations + 1 : 0;
+    int drop = m_lastBest != MOVE_NONE ? m_lastScore - score : 0;
+    m_lastBest = best;
+    m_lastScore = score;
+
+    if (m_soft == 0)
+    {
+        return false;
+    }
+
+    // A best move that keeps surviving deeper iterations needs less time; a new one needs more
+    static const double STABILITY[4] = {1.3, 1.0, 0.8, 0.6};
+    double scale = STABILITY[min(m_stableIterations, 3)];
+
+    // A falling score means trouble was just found, so look for a way out
+    if (drop > 20)
+    {
+        scale *= 1.0 + min(drop, 200) / 200.0;
+    }
+
+    double budget = min(m_soft * scale, double(m_hard));
+    // The next iteration takes longer than all the previous ones together; don't start one that can't finish by the hard limit
+    return elapsedMs >= budget || elapsedMs * 2 > m_hard;
+}
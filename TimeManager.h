@@ -0,0 +1,50 @@
+//
+//  TimeManager.h
+//  Chess
+//
+
+#ifndef TIMEMANAGER_INCLUDED
+#define TIMEMANAGER_INCLUDED
+
+#include "Move.h"
+
+const int MOVE_OVERHEAD_MS = 30; // Kept back from every budget for the GUI and the OS scheduler
+
+// Decides how long one move may take. The soft limit is what a move normally gets and is only
+// checked between iterations, scaled by how settled the search looks. The hard limit is enforced
+// inside the search and is never exceeded.
+class TimeManager
+{
+public:
+    void init(int timeMs, int incrementMs, int movesToGo, int moveTimeMs); // Remaining clock, increment and moves to the next time control (0 if none), or a fixed moveTimeMs. All zero means no limit.
+
+    int softMs() const; // 0 if there is no limit
+    int hardMs() const;
+
+    // Called after each completed iteration. Returns true if another iteration isn't worth starting.
+    bool iterationDone(double elapsedMs, Move best, int score);
+
+private:
+    int m_soft = 0;
+    int m_hard = 0;
+
+    Move m_lastBest = MOVE_NONE;
+    int m_lastScore = 0;
+    int m_stableIterations = 0; // Iterations in a row that kept the same best move
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// INLINE ACCESSORS
+////////////////////////////////////////////////////////////////////////////////////////////////
+inline int TimeManager::softMs() const
+{
+    return m_soft;
+}
+
+inline int TimeManager::hardMs() const
+{
+    return m_hard;
+}
+
+#endif /* TIMEMANAGER_INCLUDED */
@@ -0,0 +1,61 @@
+//
+//  Zobrist.cpp
+//  Chess
+//
+
+#include "Zobrist.h"
+#include <mutex>
+
+Key ZOBRIST_PIECE[12][64];
+Key ZOBRIST_CASTLING[16];
+Key ZOBRIST_EP_FILE[8];
+Key ZOBRIST_SIDE;
+
+// xorshift64*, seeded with a constant so keys are the same on every run
+static Key nextRandom()
+{
+    static Key state = 1070372ULL;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+static void fillZobrist()
+{
+    for (int pieceID = 0; pieceID < 12; pieceID++)
+    {
+        for (int sq = 0; sq < 64; sq++)
+        {
+            ZOBRIST_PIECE[pieceID][sq] = nextRandom();
+        }
+    }
+    // Each combination of rights gets the XOR of its individual keys, so updates can XOR old and new masks
+    Key rightKeys[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rightKeys[i] = nextRandom();
+    }
+    for (int rights = 0; rights < 16; rights++)
+    {
+        ZOBRIST_CASTLING[rights] = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            if (rights & (1 << i))
+            {
+                ZOBRIST_CASTLING[rights] ^= rightKeys[i];
+            }
+        }
+    }
+    for (int file = 0; file < 8; file++)
+    {
+        ZOBRIST_EP_FILE[file] = nextRandom();
+    }
+    ZOBRIST_SIDE = nextRandom();
+}
+
+void initZobrist()
+{
+    static std::once_flag once;
+    std::call_once(once, fillZobrist);
+}
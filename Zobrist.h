@@ -0,0 +1,20 @@
+//
+//  Zobrist.h
+//  Chess
+//
+
+#ifndef ZOBRIST_INCLUDED
+#define ZOBRIST_INCLUDED
+
+#include <cstdint>
+
+typedef uint64_t Key;
+
+extern Key ZOBRIST_PIECE[12][64]; // Indexed by pieceID, then square
+extern Key ZOBRIST_CASTLING[16];  // Indexed by the full castling rights mask
+extern Key ZOBRIST_EP_FILE[8];
+extern Key ZOBRIST_SIDE;          // XORed in when black is to move
+
+void initZobrist(); // Fills the key tables with fixed pseudo-random numbers. Safe to call more than once, from any thread.
+
+#endif /* ZOBRIST_INCLUDED */
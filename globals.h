@@ -37,6 +37,29 @@ const int B_KNIGHT_ID = 9;
 const int W_PAWN_ID = 10;
 const int B_PAWN_ID = 11;
 
+const int NUM_PIECE_TYPES = 6; // pieceID / 2 indexes the piece type, pieceID % 2 the color
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// CASTLING RIGHTS
+////////////////////////////////////////////////////////////////////////////////////////////////
+const int WHITE_OO = 1;
+const int WHITE_OOO = 2;
+const int BLACK_OO = 4;
+const int BLACK_OOO = 8;
+const int ALL_CASTLING = 15;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// GAME STATUS
+////////////////////////////////////////////////////////////////////////////////////////////////
+const int GAME_ONGOING = 0;
+const int GAME_CHECKMATE = 1; // The side to move is checkmated
+const int GAME_STALEMATE = 2;
+const int GAME_DRAW_REPETITION = 3; // Threefold repetition
+const int GAME_DRAW_FIFTY_MOVES = 4;
+const int GAME_DRAW_MATERIAL = 5; // Neither side can mate
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 // OTHER
@@ -45,6 +68,8 @@ const int VP_HEIGHT = 700;
 const int VP_WIDTH = 700;
 const int VP_BORDER = 70;
 
+const int FRAME_CAP = 60; // Most frames drawn per second; 0 draws as soon as a redraw is requested
+
 const int WHITE = 0;
 const int BLACK = 1;
 
@@ -53,6 +78,26 @@ const int EAST = 1;
 const int SOUTH = -1;
 const int WEST = -1;
 
+const int COMPUTER_COLOR = BLACK; // The side the computer plays in a game against it
+const int COMPUTER_CLOCK_MS = 5 * 60 * 1000; // The computer's time for the whole game; 0 gives it COMPUTER_MOVE_TIME_MS per move instead
+const int COMPUTER_INCREMENT_MS = 2000; // Added to its clock after each of its moves
+const int COMPUTER_MOVE_TIME_MS = 1000;
+const int SEARCH_POLL_MS = 30; // How often the GUI checks on a running search
+const bool COMPUTER_PONDERS = true; // Keep searching on the expected reply while the human thinks
+
 const int NUM_TEXTURES = 18;
 
+// Screens, each with its own group of textures
+const int SCREEN_MENU = 0;
+const int SCREEN_GAMEPLAY = 1;
+const int SCREEN_END = 2;
+const int NUM_SCREENS = 3;
+
+const int ATLAS_WIDTH = 1024; // Texels; the height is the smallest power of two that fits every image
+const int ATLAS_PADDING = 2; // Empty texels between images so neighbours never bleed into each other
+const int ASSET_THREADS = 4; // Most threads decoding PNGs at startup
+
+const int HISTORY_SIZE = 256; // StateInfos Board keeps, in a ring; a power of two. Enough to undo a whole search and still see the fifty-move window behind it.
+const int MAX_PIECES = 16; // Per color. Promotions replace the pawn in place, so a side never holds more than 16.
+
 #endif /* GLOBAL_INCLUDED */
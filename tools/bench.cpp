@@ -0,0 +1,100 @@
+//
+//  bench.cpp
+//  Chess
+//
+//  Micro-benchmarks for the hot paths of Board. Build and run it from the repository root, e.g.
+//      c++ -O2 -std=c++17 -I. tools/bench.cpp Board.cpp Piece.cpp Bitboard.cpp MoveGen.cpp Zobrist.cpp Evaluate.cpp Pawns.cpp Material.cpp Endgame.cpp -o bench
+//      ./bench
+//
+
+#include <chrono>
+#include <cstdio>
+#include "Board.h"
+#include "globals.h"
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// POSITIONS
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Plays {fromR, fromC, toR, toC} moves from the starting position.
+static Board playMoves(const int moves[][4], int numMoves)
+{
+    Board b;
+    for (int i = 0; i < numMoves; i++)
+    {
+        Piece* piece = b.pieceAtPos(moves[i][0], moves[i][1]);
+        if (piece == nullptr || !b.attemptMove(piece, moves[i][2], moves[i][3]))
+        {
+            fprintf(stderr, "illegal bench move %d\n", i);
+        }
+    }
+    return b;
+}
+
+static const int ITALIAN[][4] = {
+    {2, 5, 4, 5}, {7, 5, 5, 5}, {1, 7, 3, 6}, {8, 2, 6, 3}, {1, 6, 4, 3}, {8, 6, 5, 3},
+    {2, 3, 3, 3}, {8, 7, 6, 6}, {2, 4, 3, 4}, {7, 4, 6, 4}, {1, 5, 1, 7}, {8, 5, 8, 7},
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// BENCHMARKS
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Average cost of one squareInCheck query, probing every square for both attackers.
+static double benchSquareInCheck(Board& b, int iterations)
+{
+    volatile int hits = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (int r = 1; r <= 8; r++)
+        {
+            for (int c = 1; c <= 8; c++)
+            {
+                hits += b.squareInCheck(r, c, WHITE);
+                hits += b.squareInCheck(r, c, BLACK);
+            }
+        }
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / (iterations * 128.0);
+}
+
+// Average cost of one movePossible query (the legality check behind move highlighting), over every piece and square.
+static double benchMovePossible(Board& b, int iterations)
+{
+    volatile int legal = 0;
+    long queries = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (int color = WHITE; color <= BLACK; color++)
+        {
+            for (int p = 0; p < b.numPieces(color); p++)
+            {
+                for (int r = 1; r <= 8; r++)
+                {
+                    for (int c = 1; c <= 8; c++)
+                    {
+                        legal += b.movePossible(&b.pieces(color)[p], r, c);
+                        queries++;
+                    }
+                }
+            }
+        }
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / queries;
+}
+
+int main()
+{
+    Board start;
+    Board italian = playMoves(ITALIAN, sizeof(ITALIAN) / sizeof(ITALIAN[0]));
+
+    printf("squareInCheck  start:   %7.1f ns/query\n", benchSquareInCheck(start, 20000));
+    printf("squareInCheck  italian: %7.1f ns/query\n", benchSquareInCheck(italian, 20000));
+    printf("movePossible   start:   %7.1f ns/query\n", benchMovePossible(start, 500));
+    printf("movePossible   italian: %7.1f ns/query\n", benchMovePossible(italian, 500));
+    return 0;
+}
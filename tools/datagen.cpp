@@ -0,0 +1,235 @@
+//
+//  datagen.cpp
+//  Chess
+//
+//  Headless self-play for training data. Every worker thread plays one game at a time: a few
+//  random moves, then fixed-node searches for both sides until the game ends or is adjudicated.
+//  Each quiet position searched is written as a PackedPosition, with its score and the game's outcome. Build and run it
+//  from the repository root, e.g.
+//      c++ -O3 -std=c++17 -I. tools/datagen.cpp Board.cpp Piece.cpp Bitboard.cpp MoveGen.cpp Zobrist.cpp Search.cpp Evaluate.cpp TT.cpp TimeManager.cpp Pawns.cpp Material.cpp Endgame.cpp Nnue.cpp EvalCache.cpp PackedPosition.cpp -o datagen -lpthread
+//      ./datagen selfplay.bin [games] [nodes] [threads] [seed]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "MoveGen.h"
+#include "PackedPosition.h"
+#include "Search.h"
+using namespace std;
+
+const int DEFAULT_GAMES = 1000;
+const int DEFAULT_NODES = 5000;
+const int OPENING_PLIES = 8;       // Random moves before the searches take over; one more half the time, so both colors get to start
+const int MAX_GAME_LENGTH = 400;   // Plies; longer games are called drawn
+const int WIN_SCORE = 1000;        // A side this far ahead for WIN_PLIES plies in a row is called the winner
+const int WIN_PLIES = 8;
+const int DRAW_SCORE = 10;         // Both sides this close to zero for DRAW_PLIES plies, after DRAW_MIN_PLY, is called a draw
+const int DRAW_PLIES = 16;
+const int DRAW_MIN_PLY = 80;
+const size_t FLUSH_RECORDS = 1 << 16; // A worker hands its records to the file once it holds this many,
+const int FLUSH_SECONDS = 30;          // or once this long has passed since it last did
+const int REPORT_SECONDS = 10;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// OUTPUT
+////////////////////////////////////////////////////////////////////////////////////////////////
+// Shared by the workers. Records arrive a whole game at a time, so the file never holds half a game.
+class DataWriter
+{
+public:
+    explicit DataWriter(PackedWriter& file) : m_file(file) {}
+
+    void write(vector<PackedPosition>& records)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_file.write(records.data(), records.size());
+        m_file.flush();
+        records.clear();
+    }
+
+private:
+    PackedWriter& m_file;
+    mutex m_mutex;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// SELF-PLAY
+////////////////////////////////////////////////////////////////////////////////////////////////
+struct Progress
+{
+    atomic<int> gamesStarted{0};
+    atomic<int> gamesDone{0};
+    atomic<uint64_t> positions{0};
+    atomic<int> results[3] = {{0}, {0}, {0}};
+};
+
+// Plays random legal moves. Returns false if the game ended on the way, so the opening is useless.
+static bool playOpening(Board& b, mt19937_64& rng)
+{
+    int plies = OPENING_PLIES + int(rng() & 1);
+    Move moves[MAX_MOVES];
+    for (int i = 0; i < plies; i++)
+    {
+        int count = int(generateLegalMoves(b, moves) - moves);
+        if (count == 0)
+        {
+            return false;
+        }
+        b.doMove(moves[rng() % count]);
+    }
+    return b.gameStatus() == GAME_ONGOING;
+}
+
+// Plays one game and appends its positions to records. Returns the result, one of the PACKED_ constants.
+static int playGame(Search& search, const SearchLimits& limits, mt19937_64& rng, vector<PackedPosition>& records)
+{
+    Board b;
+    while (!playOpening(b, rng))
+    {
+        b = Board();
+    }
+    search.clearHash();
+
+    size_t first = records.size();
+    int result = PACKED_DRAW;
+    int winPlies = 0;
+    int drawPlies = 0;
+    for (int ply = 0; ; ply++)
+    {
+        int status = b.gameStatus();
+        if (status != GAME_ONGOING)
+        {
+            result = status != GAME_CHECKMATE ? PACKED_DRAW : b.sideToMove() == WHITE ? PACKED_BLACK_WON : PACKED_WHITE_WON;
+            break;
+        }
+        if (ply >= MAX_GAME_LENGTH)
+        {
+            break;
+        }
+
+        SearchInfo info = search.think(b, limits);
+        int whiteScore = b.sideToMove() == WHITE ? info.score : -info.score;
+
+        // Adjudicate clear wins and dead draws instead of playing them out
+        winPlies = abs(info.score) >= WIN_SCORE ? winPlies + 1 : 0;
+        drawPlies = abs(info.score) <= DRAW_SCORE ? drawPlies + 1 : 0;
+        if (winPlies >= WIN_PLIES)
+        {
+            result = whiteScore > 0 ? PACKED_WHITE_WON : PACKED_BLACK_WON;
+            break;
+        }
+        if (ply >= DRAW_MIN_PLY && drawPlies >= DRAW_PLIES)
+        {
+            break;
+        }
+
+        // Positions in check or about to capture aren't quiet, and mate scores say nothing about the evaluation
+        if (!b.inCheck() && !b.isCapture(info.bestMove) && moveType(info.bestMove) != MOVE_PROMOTION && abs(info.score) < SCORE_MATE_IN_MAX_PLY)
+        {
+            records.push_back(packPosition(b, whiteScore));
+        }
+        b.doMove(info.bestMove);
+    }
+
+    for (size_t i = first; i < records.size(); i++)
+    {
+        records[i].result = uint8_t(result);
+    }
+    return result;
+}
+
+static void worker(int games, uint64_t seed, const SearchLimits& limits, DataWriter& writer, Progress& progress)
+{
+    Search search;
+    mt19937_64 rng(seed);
+    vector<PackedPosition> records;
+    auto lastFlush = chrono::steady_clock::now();
+    while (progress.gamesStarted++ < games)
+    {
+        size_t before = records.size();
+        int result = playGame(search, limits, rng, records);
+        progress.positions += records.size() - before;
+        progress.results[result]++;
+        progress.gamesDone++;
+        if (records.size() >= FLUSH_RECORDS || chrono::steady_clock::now() - lastFlush >= chrono::seconds(FLUSH_SECONDS))
+        {
+            writer.write(records);
+            lastFlush = chrono::steady_clock::now();
+        }
+    }
+    writer.write(records);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// main
+////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s output.bin [games] [nodes] [threads] [seed]\n", argv[0]);
+        return 1;
+    }
+    int games = argc > 2 ? atoi(argv[2]) : DEFAULT_GAMES;
+    SearchLimits limits;
+    limits.nodes = argc > 3 ? strtoull(argv[3], nullptr, 10) : DEFAULT_NODES;
+    int threads = max(1, argc > 4 ? atoi(argv[4]) : (int)thread::hardware_concurrency());
+    uint64_t seed = argc > 5 ? strtoull(argv[5], nullptr, 10) : uint64_t(chrono::steady_clock::now().time_since_epoch().count());
+
+    PackedWriter file;
+    if (!file.open(argv[1])) // Appends, so several runs can feed one file
+    {
+        fprintf(stderr, "can't open %s\n", argv[1]);
+        return 1;
+    }
+    printf("%d games, %llu nodes per move, %d threads, seed %llu\n", games, (unsigned long long)limits.nodes, threads, (unsigned long long)seed);
+
+    DataWriter writer(file);
+    Progress progress;
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back(worker, games, seed + t * 0x9E3779B97F4A7C15ULL, cref(limits), ref(writer), ref(progress));
+    }
+
+    // Report while the workers play, then once more at the end
+    auto start = chrono::steady_clock::now();
+    auto report = [&]()
+    {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        uint64_t positions = progress.positions;
+        printf("%6d games  %10llu positions  %8.0f positions/s/core  +%d =%d -%d\n", progress.gamesDone.load(),
+               (unsigned long long)positions, positions / elapsed.count() / threads,
+               progress.results[PACKED_WHITE_WON].load(), progress.results[PACKED_DRAW].load(), progress.results[PACKED_BLACK_WON].load());
+        fflush(stdout);
+    };
+    int lastReport = 0;
+    while (progress.gamesDone < games)
+    {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        int seconds = int(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        if (seconds >= lastReport + REPORT_SECONDS)
+        {
+            lastReport = seconds;
+            report();
+        }
+    }
+    for (thread& t : workers)
+    {
+        t.join();
+    }
+    report();
+    return 0;
+}
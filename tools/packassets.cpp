@@ -0,0 +1,70 @@
+//
+//  packassets.cpp
+//  Chess
+//
+//  Decodes assets/*.png once and writes them to assets.pack, which the game maps at startup
+//  instead of decoding the PNGs. Copy the pack next to the Chess binary. Build and run it from
+//  the repository root, e.g.
+//      c++ -O2 -std=c++17 -I. tools/packassets.cpp Assets.cpp -o packassets -lpthread
+//      ./packassets assets assets.pack
+//
+
+#include <cstdio>
+#include <cstring>
+#include "Assets.h"
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    const char* assetDir = argc > 1 ? argv[1] : "assets";
+    const char* outPath = argc > 2 ? argv[2] : "assets.pack";
+
+    AssetStore assets;
+    if (!assets.loadPNGs(assetDir))
+    {
+        return 1;
+    }
+
+    PackHeader header;
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.count = NUM_TEXTURES;
+    header.reserved = 0;
+
+    // Pixels follow the index, each image starting on a 16-byte boundary
+    PackEntry entries[NUM_TEXTURES];
+    uint64_t offset = sizeof(PackHeader) + sizeof(entries);
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        offset = (offset + 15) & ~uint64_t(15);
+        entries[i].width = assets.width(i);
+        entries[i].height = assets.height(i);
+        entries[i].offset = offset;
+        offset += uint64_t(assets.width(i)) * assets.height(i) * 4;
+    }
+
+    FILE* out = fopen(outPath, "wb");
+    if (out == nullptr)
+    {
+        perror(outPath);
+        return 1;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(entries, sizeof(entries), 1, out) == 1;
+    uint64_t written = sizeof(PackHeader) + sizeof(entries);
+    for (int i = 0; ok && i < NUM_TEXTURES; i++)
+    {
+        static const char zeros[16] = {};
+        ok = fwrite(zeros, 1, entries[i].offset - written, out) == entries[i].offset - written;
+        size_t bytes = size_t(assets.width(i)) * assets.height(i) * 4;
+        ok = ok && fwrite(assets.pixels(i), 1, bytes, out) == bytes;
+        written = entries[i].offset + bytes;
+    }
+    if (fclose(out) != 0 || !ok)
+    {
+        fprintf(stderr, "failed writing %s\n", outPath);
+        return 1;
+    }
+
+    printf("wrote %d images, %llu bytes to %s\n", NUM_TEXTURES, (unsigned long long)written, outPath);
+    return 0;
+}
@@ -0,0 +1,81 @@
+//
+//  perft.cpp
+//  Chess
+//
+//  Counts the leaf nodes of the legal move tree from well-known positions and compares them
+//  with the published counts, so a move generation or doMove/undoMove regression shows up as a
+//  wrong number. Exits with status 1 on any mismatch. Build and run it from the repository root, e.g.
+//      c++ -O2 -std=c++17 -I. tools/perft.cpp Board.cpp Piece.cpp Bitboard.cpp MoveGen.cpp Zobrist.cpp Evaluate.cpp Pawns.cpp Material.cpp Endgame.cpp -o perft
+//      ./perft
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include "Board.h"
+#include "MoveGen.h"
+using namespace std;
+
+struct PerftCase
+{
+    const char* name;
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+// The standard suite from the Chess Programming Wiki's perft results page
+static const PerftCase CASES[] =
+{
+    {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+    {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+};
+
+static uint64_t perft(Board& b, int depth)
+{
+    Move moves[MAX_MOVES];
+    Move* end = generateLegalMoves(b, moves);
+    if (depth == 1)
+    {
+        return end - moves;
+    }
+    uint64_t nodes = 0;
+    for (Move* m = moves; m != end; m++)
+    {
+        b.doMove(*m);
+        nodes += perft(b, depth - 1);
+        b.undoMove();
+    }
+    return nodes;
+}
+
+int main()
+{
+    int failures = 0;
+    for (const PerftCase& c : CASES)
+    {
+        Board b;
+        if (!b.setFen(c.fen))
+        {
+            printf("%-10s  can't parse %s\n", c.name, c.fen);
+            failures++;
+            continue;
+        }
+        auto start = chrono::steady_clock::now();
+        uint64_t nodes = perft(b, c.depth);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        bool ok = nodes == c.nodes;
+        failures += !ok;
+        printf("%-10s  depth %d  %10llu nodes  %s  %6.1f Mnps\n", c.name, c.depth, (unsigned long long)nodes,
+               ok ? "ok      " : "MISMATCH", nodes / elapsed.count() / 1e6);
+        if (!ok)
+        {
+            printf("            expected %llu\n", (unsigned long long)c.nodes);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+//
+//  seecheck.cpp
+//  Chess
+//
+//  Checks Board::see against a brute-force exchange search on every capture of random games.
+//  The reference plays the capture sequence out with doMove, always retaking with the cheapest
+//  piece, and either side may stop when retaking would lose. Like see, it ignores pins, and it
+//  only promotes to a queen, so captures onto the back ranks are left out. Each capture is tried
+//  against a spread of thresholds. Exits with status 1 on any mismatch. Build and run it from the
+//  repository root, e.g.
+//      c++ -O2 -std=c++17 -I. tools/seecheck.cpp Board.cpp Piece.cpp Bitboard.cpp MoveGen.cpp Zobrist.cpp Evaluate.cpp Pawns.cpp Material.cpp Endgame.cpp -o seecheck
+//      ./seecheck [games] [seed]
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "Board.h"
+#include "Evaluate.h"
+#include "MoveGen.h"
+using namespace std;
+
+const int DEFAULT_GAMES = 3000;
+const int GAME_LENGTH = 120;         // Plies per random game
+const int KING_ORDER = 100000;       // Sorts the king after every other attacker
+const int MIN_THRESHOLD = -1000;
+const int MAX_THRESHOLD = 1000;
+const int THRESHOLD_STEP = 37;       // Odd, so the thresholds land between the piece values too
+const int MAX_REPORTED = 5;
+
+static int value(int pieceID)
+{
+    return PIECE_VALUE[pieceID / 2];
+}
+
+// Best the side to move can get from capturing on sq, with the other side answering the same way. 0 if it shouldn't capture.
+static int exchange(Board& b, int sq)
+{
+    Move moves[MAX_MOVES];
+    Move* end = generatePseudoLegalMoves(b, moves);
+    Move cheapest = MOVE_NONE;
+    int cheapestOrder = KING_ORDER + 1;
+    for (Move* m = moves; m != end; m++)
+    {
+        if (moveTo(*m) != sq || moveType(*m) == MOVE_CASTLING || (moveType(*m) == MOVE_PROMOTION && promotionType(*m) != QUEEN_ID))
+        {
+            continue;
+        }
+        int pieceID = b.pieceIDAt(moveFrom(*m));
+        bool king = pieceID / 2 == KING_ID / 2;
+        if (king && !b.legal(*m)) // The king can't take a defended piece
+        {
+            continue;
+        }
+        int order = king ? KING_ORDER : value(pieceID);
+        if (order < cheapestOrder)
+        {
+            cheapestOrder = order;
+            cheapest = *m;
+        }
+    }
+    if (cheapest == MOVE_NONE)
+    {
+        return 0;
+    }
+    int captured = value(b.pieceIDAt(sq));
+    b.doMove(cheapest);
+    int result = max(0, captured - exchange(b, sq));
+    b.undoMove();
+    return result;
+}
+
+// What m wins once the exchange it starts has played out
+static int referenceSee(Board& b, Move m)
+{
+    int to = moveTo(m);
+    int gain = moveType(m) == MOVE_EN_PASSANT ? value(PAWN_ID) : b.pieceIDAt(to) >= 0 ? value(b.pieceIDAt(to)) : 0;
+    if (moveType(m) == MOVE_PROMOTION)
+    {
+        gain += value(promotionType(m)) - value(PAWN_ID);
+    }
+    b.doMove(m);
+    int result = gain - exchange(b, to);
+    b.undoMove();
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    int games = argc > 1 ? atoi(argv[1]) : DEFAULT_GAMES;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1;
+
+    mt19937_64 rng(seed);
+    uint64_t captures = 0;
+    uint64_t checks = 0;
+    uint64_t mismatches = 0;
+    for (int game = 0; game < games; game++)
+    {
+        Board b;
+        Move moves[MAX_MOVES];
+        for (int ply = 0; ply < GAME_LENGTH && b.rule50() < 100; ply++)
+        {
+            int count = int(generateLegalMoves(b, moves) - moves);
+            if (count == 0)
+            {
+                break;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                Move m = moves[i];
+                int row = squareRow(moveTo(m));
+                if (!b.isCapture(m) || row == 1 || row == 8)
+                {
+                    continue;
+                }
+                captures++;
+                int expected = referenceSee(b, m);
+                for (int threshold = MIN_THRESHOLD; threshold <= MAX_THRESHOLD; threshold += THRESHOLD_STEP)
+                {
+                    checks++;
+                    if (b.see(m, threshold) != (expected >= threshold) && mismatches++ < MAX_REPORTED)
+                    {
+                        printf("game %d ply %d: %s should win %d, but see(%d) is %d\n", game, ply, moveToString(m).c_str(),
+                               expected, threshold, int(b.see(m, threshold)));
+                    }
+                }
+            }
+            b.doMove(moves[rng() % count]);
+        }
+    }
+    printf("%llu captures, %llu checks, %llu mismatches\n", (unsigned long long)captures, (unsigned long long)checks,
+           (unsigned long long)mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+//
+//  startupbench.cpp
+//  Chess
+//
+//  Measures how long the game takes to get its images into memory at startup, from the PNGs
+//  and from the asset pack. Each load also reads every pixel once, as the atlas upload would,
+//  so the pack's page faults are counted. "menu ready" is how long the first screen waits when
+//  the PNGs are decoded in the background, menu buttons first. Build with -DTRACE_STARTUP to
+//  see when each image finishes. Build and run it from the repository root, e.g.
+//      c++ -O2 -std=c++17 -I. tools/startupbench.cpp Assets.cpp -o startupbench -lpthread
+//      ./startupbench . 50
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "Assets.h"
+using namespace std;
+
+// Sums every pixel byte so the loads can't be optimized away and mapped pages are really read.
+static unsigned long touchPixels(const AssetStore& assets)
+{
+    unsigned long sum = 0;
+    for (int i = 0; i < NUM_TEXTURES; i++)
+    {
+        const unsigned char* p = assets.pixels(i);
+        size_t bytes = size_t(assets.width(i)) * assets.height(i) * 4;
+        for (size_t j = 0; j < bytes; j += 64)
+        {
+            sum += p[j];
+        }
+    }
+    return sum;
+}
+
+// Average milliseconds per load, or -1 if loading failed.
+template<class Load>
+static double benchLoad(Load load, int iterations)
+{
+    volatile unsigned long sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        AssetStore assets;
+        if (!load(assets))
+        {
+            return -1;
+        }
+        sink += touchPixels(assets);
+    }
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+// Average milliseconds until the menu buttons (textures 12 and 13) are decoded, or -1 if loading failed.
+static double benchMenuReady(const string& dir, int iterations)
+{
+    const int order[NUM_TEXTURES] = {12, 13, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 14, 15, 16, 17};
+    double total = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        AssetStore assets;
+        auto start = chrono::steady_clock::now();
+        if (!assets.startPNGs(dir, order) || !assets.waitFor(12, 13))
+        {
+            return -1;
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        total += elapsed.count();
+    }
+    return total / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    string baseDir = argc > 1 ? argv[1] : ".";
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    double png = benchLoad([&](AssetStore& a) { return a.loadPNGs(baseDir + "/assets"); }, iterations);
+    double menu = benchMenuReady(baseDir + "/assets", iterations);
+    double pack = benchLoad([&](AssetStore& a) { return a.loadPack(baseDir + "/assets.pack"); }, iterations);
+
+    printf("decode PNGs:  %8.3f ms\n", png);
+    printf("menu ready:   %8.3f ms\n", menu);
+    if (pack < 0)
+    {
+        printf("map pack:     no %s/assets.pack, build it with tools/packassets\n", baseDir.c_str());
+    }
+    else
+    {
+        printf("map pack:     %8.3f ms\n", pack);
+    }
+    return 0;
+}
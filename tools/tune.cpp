@@ -0,0 +1,556 @@
+//
+//  tune.cpp
+//  Chess
+//
+//  Texel tuning: fits every weight in EvalTerms so that a sigmoid of the static evaluation best
+//  predicts the game results of a set of quiet positions, then prints the weights in the layout of
+//  the tables in Evaluate.cpp, Pawns.cpp and Material.cpp. Build and run it from the repository root, e.g.
+//      c++ -O3 -std=c++17 -I. tools/tune.cpp Board.cpp Piece.cpp Bitboard.cpp MoveGen.cpp Zobrist.cpp Evaluate.cpp Pawns.cpp Material.cpp Endgame.cpp PackedPosition.cpp -o tune -lpthread
+//      ./tune selfplay.bin [epochs] [threads]
+//  The input is either a packed position file, as written by tools/datagen, or text with a FEN per
+//  line followed by the game result, as 1-0, 0-1 or 1/2-1/2 (quotes and a trailing ; are fine, as
+//  in c9 "1-0";) or as [1.0], [0.5] or [0.0].
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "Evaluate.h"
+#include "Material.h"
+#include "PackedPosition.h"
+#include "Pawns.h"
+using namespace std;
+
+const int DEFAULT_EPOCHS = 2000;
+const int REPORT_EVERY = 50;      // Epochs between progress lines
+const int LOAD_BATCH = 1 << 20;   // Lines or records parsed in parallel at a time
+const double LEARNING_RATE = 1.0; // Adam step size, in centipawns
+const double BETA1 = 0.9;
+const double BETA2 = 0.999;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// DATASET
+////////////////////////////////////////////////////////////////////////////////////////////////
+// A position reduced to what the linear model needs. The nonzero trace counts of all positions
+// sit back to back in one array, so an epoch streams through memory once.
+struct TunePosition
+{
+    float result;       // 1 white won, 0.5 draw, 0 black won
+    int16_t fixedMg;
+    int16_t fixedEg;
+    uint32_t first;     // Index of the first coefficient
+    uint16_t count;     // Number of coefficients
+    uint8_t phase;
+    uint8_t scale;
+};
+
+struct Coefficient
+{
+    uint16_t term;      // Index into EvalTerms viewed as an int array
+    int16_t count;
+};
+
+struct Dataset
+{
+    vector<TunePosition> positions;
+    vector<Coefficient> coefficients;
+};
+
+static_assert(NUM_EVAL_TERMS < 65536, "term indices are stored in 16 bits");
+
+// Returns the result in white's terms, or a negative number if the line doesn't have one
+static float parseResult(const string& line)
+{
+    if (line.find("1/2-1/2") != string::npos || line.find("[0.5]") != string::npos)
+    {
+        return 0.5f;
+    }
+    if (line.find("1-0") != string::npos || line.find("[1.0]") != string::npos)
+    {
+        return 1.0f;
+    }
+    if (line.find("0-1") != string::npos || line.find("[0.0]") != string::npos)
+    {
+        return 0.0f;
+    }
+    return -1.0f;
+}
+
+// Adds b, with its result, to out. Each loading thread fills its own dataset, merged afterwards.
+static void addPosition(const Board& b, float result, PawnTable& pawns, MaterialTable& material, Dataset& out)
+{
+    EvalTrace trace;
+    evaluate(b, pawns, material, &trace);
+    if (trace.endgame) // Specialized evaluators don't use the weights
+    {
+        return;
+    }
+
+    TunePosition p;
+    p.result = result;
+    p.fixedMg = int16_t(trace.fixedMg);
+    p.fixedEg = int16_t(trace.fixedEg);
+    p.first = uint32_t(out.coefficients.size());
+    p.phase = uint8_t(trace.phase);
+    p.scale = uint8_t(trace.scale);
+    const int* counts = reinterpret_cast<const int*>(&trace.count);
+    for (int term = 0; term < NUM_EVAL_TERMS; term++)
+    {
+        if (counts[term] != 0)
+        {
+            out.coefficients.push_back({uint16_t(term), int16_t(counts[term])});
+        }
+    }
+    p.count = uint16_t(out.coefficients.size() - p.first);
+    out.positions.push_back(p);
+}
+
+static void parseLines(const vector<string>& lines, size_t begin, size_t end, Dataset& out)
+{
+    Board b;
+    PawnTable pawns;
+    MaterialTable material;
+    for (size_t i = begin; i < end; i++)
+    {
+        float result = parseResult(lines[i]);
+        if (result >= 0 && b.setFen(lines[i]))
+        {
+            addPosition(b, result, pawns, material, out);
+        }
+    }
+}
+
+static void parseRecords(const PackedReader& reader, size_t begin, size_t end, Dataset& out)
+{
+    Board b;
+    PawnTable pawns;
+    MaterialTable material;
+    for (size_t i = begin; i < end; i++)
+    {
+        const PackedPosition& p = reader[i];
+        if (p.result <= PACKED_WHITE_WON && unpackPosition(p, b))
+        {
+            addPosition(b, p.result / 2.0f, pawns, material, out);
+        }
+    }
+}
+
+static void appendDataset(Dataset& to, const Dataset& from)
+{
+    uint32_t offset = uint32_t(to.coefficients.size());
+    to.coefficients.insert(to.coefficients.end(), from.coefficients.begin(), from.coefficients.end());
+    for (TunePosition p : from.positions)
+    {
+        p.first += offset;
+        to.positions.push_back(p);
+    }
+}
+
+// Records from a file written by datagen, split across threads
+static bool loadPacked(const char* path, int threads, Dataset& data)
+{
+    PackedReader reader;
+    if (!reader.open(path))
+    {
+        return false;
+    }
+    size_t read = 0;
+    while (read < reader.size())
+    {
+        size_t batch = min(reader.size() - read, (size_t)LOAD_BATCH);
+        vector<Dataset> parts(threads);
+        vector<thread> workers;
+        size_t chunk = (batch + threads - 1) / threads;
+        for (int t = 0; t < threads; t++)
+        {
+            size_t begin = read + min(batch, t * chunk);
+            size_t end = min(read + batch, begin + chunk);
+            workers.emplace_back(parseRecords, cref(reader), begin, end, ref(parts[t]));
+        }
+        for (int t = 0; t < threads; t++)
+        {
+            workers[t].join();
+            appendDataset(data, parts[t]);
+        }
+        read += batch;
+        if (data.coefficients.size() > UINT32_MAX - (size_t)LOAD_BATCH * NUM_EVAL_TERMS)
+        {
+            fprintf(stderr, "dataset too large, stopping after %zu records\n", read);
+            break;
+        }
+    }
+    printf("%zu records, %zu positions used, %.1f coefficients per position\n", read, data.positions.size(),
+           data.positions.empty() ? 0.0 : double(data.coefficients.size()) / data.positions.size());
+    return !data.positions.empty();
+}
+
+static bool loadDataset(const char* path, int threads, Dataset& data)
+{
+    if (isPackedFile(path))
+    {
+        return loadPacked(path, threads, data);
+    }
+
+    ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+
+    vector<string> lines;
+    string line;
+    size_t read = 0;
+    while (true)
+    {
+        lines.clear();
+        while ((int)lines.size() < LOAD_BATCH && getline(in, line))
+        {
+            lines.push_back(line);
+        }
+        if (lines.empty())
+        {
+            break;
+        }
+        read += lines.size();
+
+        vector<Dataset> parts(threads);
+        vector<thread> workers;
+        size_t chunk = (lines.size() + threads - 1) / threads;
+        for (int t = 0; t < threads; t++)
+        {
+            size_t begin = min(lines.size(), t * chunk);
+            size_t end = min(lines.size(), begin + chunk);
+            workers.emplace_back(parseLines, cref(lines), begin, end, ref(parts[t]));
+        }
+        for (int t = 0; t < threads; t++)
+        {
+            workers[t].join();
+            appendDataset(data, parts[t]);
+        }
+        if (data.coefficients.size() > UINT32_MAX - (size_t)LOAD_BATCH * NUM_EVAL_TERMS)
+        {
+            fprintf(stderr, "dataset too large, stopping after %zu lines\n", read);
+            break;
+        }
+    }
+    printf("%zu lines, %zu positions used, %.1f coefficients per position\n", read, data.positions.size(),
+           data.positions.empty() ? 0.0 : double(data.coefficients.size()) / data.positions.size());
+    return !data.positions.empty();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// MODEL
+////////////////////////////////////////////////////////////////////////////////////////////////
+// How the tuner may change each weight. Terms the evaluation only uses in one phase keep the
+// other at zero, and tied terms share one weight across both phases.
+enum TermKind { TERM_BOTH, TERM_MG_ONLY, TERM_EG_ONLY, TERM_TIED };
+
+static const EvalTerms TERMS = EvalTerms(); // Only its field addresses are used, to find each term's index
+
+static int termIndex(const int* field)
+{
+    return int(field - reinterpret_cast<const int*>(&TERMS));
+}
+
+static vector<TermKind> termKinds()
+{
+    const EvalTerms& t = TERMS;
+    vector<TermKind> kinds(NUM_EVAL_TERMS, TERM_BOTH);
+    for (int rank = 0; rank < 8; rank++)
+    {
+        kinds[termIndex(&t.freePasser[rank])] = TERM_EG_ONLY;
+    }
+    kinds[termIndex(&t.shieldOneAhead)] = TERM_MG_ONLY;
+    kinds[termIndex(&t.shieldTwoAhead)] = TERM_MG_ONLY;
+    kinds[termIndex(&t.shieldMissing)] = TERM_MG_ONLY;
+    kinds[termIndex(&t.knightPerPawn)] = TERM_TIED;
+    kinds[termIndex(&t.rookPerPawn)] = TERM_TIED;
+    return kinds;
+}
+
+// White's score in centipawns, as evaluate() would compute it with these weights
+static double modelEval(const Dataset& data, const TunePosition& p, const double* mg, const double* eg, double& mgSum, double& egSum)
+{
+    mgSum = p.fixedMg;
+    egSum = p.fixedEg;
+    const Coefficient* c = &data.coefficients[p.first];
+    for (int i = 0; i < p.count; i++)
+    {
+        mgSum += c[i].count * mg[c[i].term];
+        egSum += c[i].count * eg[c[i].term];
+    }
+    return (mgSum * p.phase + egSum * p.scale / SCALE_NORMAL * (PHASE_MAX - p.phase)) / PHASE_MAX;
+}
+
+static double sigmoid(double k, double score)
+{
+    return 1.0 / (1.0 + pow(10.0, -k * score / 400.0));
+}
+
+// Sum of squared errors over positions [begin, end), and optionally its gradient, added to grad
+static double errorSlice(const Dataset& data, size_t begin, size_t end, double k, const double* mg, const double* eg, double* gradMg, double* gradEg)
+{
+    const double dsigma = k * log(10.0) / 400.0;
+    double error = 0;
+    for (size_t n = begin; n < end; n++)
+    {
+        const TunePosition& p = data.positions[n];
+        double mgSum, egSum;
+        double s = sigmoid(k, modelEval(data, p, mg, eg, mgSum, egSum));
+        double diff = p.result - s;
+        error += diff * diff;
+        if (gradMg == nullptr)
+        {
+            continue;
+        }
+
+        // d(diff^2)/d(score), then the score's slope in each phase
+        double d = -2.0 * diff * s * (1.0 - s) * dsigma;
+        double dMg = d * p.phase / PHASE_MAX;
+        double dEg = d * (PHASE_MAX - p.phase) / PHASE_MAX * p.scale / SCALE_NORMAL;
+        const Coefficient* c = &data.coefficients[p.first];
+        for (int i = 0; i < p.count; i++)
+        {
+            gradMg[c[i].term] += dMg * c[i].count;
+            gradEg[c[i].term] += dEg * c[i].count;
+        }
+    }
+    return error;
+}
+
+// Mean squared error over the whole set, split across threads. Fills grad when it isn't null.
+static double totalError(const Dataset& data, int threads, double k, const double* mg, const double* eg, vector<double>* gradMg, vector<double>* gradEg)
+{
+    size_t total = data.positions.size();
+    size_t chunk = (total + threads - 1) / threads;
+    vector<double> errors(threads, 0.0);
+    vector<vector<double>> partMg(threads), partEg(threads);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        size_t begin = min(total, t * chunk);
+        size_t end = min(total, begin + chunk);
+        if (gradMg != nullptr)
+        {
+            partMg[t].assign(NUM_EVAL_TERMS, 0.0);
+            partEg[t].assign(NUM_EVAL_TERMS, 0.0);
+        }
+        workers.emplace_back([&, t, begin, end]()
+        {
+            errors[t] = errorSlice(data, begin, end, k, mg, eg, gradMg ? partMg[t].data() : nullptr, gradMg ? partEg[t].data() : nullptr);
+        });
+    }
+
+    double error = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+        error += errors[t];
+        if (gradMg != nullptr)
+        {
+            for (int i = 0; i < NUM_EVAL_TERMS; i++)
+            {
+                (*gradMg)[i] += partMg[t][i] / total;
+                (*gradEg)[i] += partEg[t][i] / total;
+            }
+        }
+    }
+    return error / total;
+}
+
+// The sigmoid scale that best fits the current weights, by golden section search. Fixed afterwards,
+// so the weights stay in centipawns.
+static double findK(const Dataset& data, int threads, const double* mg, const double* eg)
+{
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    double lo = 0.1, hi = 3.0;
+    double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+    double ea = totalError(data, threads, a, mg, eg, nullptr, nullptr);
+    double eb = totalError(data, threads, b, mg, eg, nullptr, nullptr);
+    for (int i = 0; i < 30; i++)
+    {
+        if (ea < eb)
+        {
+            hi = b;
+            b = a;
+            eb = ea;
+            a = hi - ratio * (hi - lo);
+            ea = totalError(data, threads, a, mg, eg, nullptr, nullptr);
+        }
+        else
+        {
+            lo = a;
+            a = b;
+            ea = eb;
+            b = lo + ratio * (hi - lo);
+            eb = totalError(data, threads, b, mg, eg, nullptr, nullptr);
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// OUTPUT
+////////////////////////////////////////////////////////////////////////////////////////////////
+static int rounded(double w)
+{
+    return int(lround(w));
+}
+
+static void printArray(const char* name, const double* w, int n)
+{
+    printf("const int %s[%d] = {", name, n);
+    for (int i = 0; i < n; i++)
+    {
+        printf(i ? ", %d" : "%d", rounded(w[i]));
+    }
+    printf("};\n");
+}
+
+static void printTable(const char* name, const double* w)
+{
+    static const char* NAMES[NUM_PIECE_TYPES] = {"King", "Queen", "Rook", "Bishop", "Knight", "Pawn"};
+    printf("static const int %s[NUM_PIECE_TYPES][64] = {\n", name);
+    for (int type = 0; type < NUM_PIECE_TYPES; type++)
+    {
+        printf("    { // %s\n", NAMES[type]);
+        for (int row = 0; row < 8; row++)
+        {
+            printf("       ");
+            for (int col = 0; col < 8; col++)
+            {
+                printf("%4d,", rounded(w[type * 64 + row * 8 + col]));
+            }
+            printf("\n");
+        }
+        printf("    },\n");
+    }
+    printf("};\n");
+}
+
+static void printWeights(const double* mg, const double* eg)
+{
+    const EvalTerms& t = TERMS;
+    auto at = [&](const int* field) { return termIndex(field); };
+
+    printf("\n// Evaluate.h\n");
+    printArray("PIECE_VALUE_MG", &mg[at(t.material)], NUM_PIECE_TYPES);
+    printArray("PIECE_VALUE_EG", &eg[at(t.material)], NUM_PIECE_TYPES);
+
+    printf("\n// Evaluate.cpp\n");
+    printArray("FREE_PASSER_EG", &eg[at(t.freePasser)], 8);
+    printArray("MOBILITY_MG", &mg[at(t.mobility)], NUM_PIECE_TYPES);
+    printArray("MOBILITY_EG", &eg[at(t.mobility)], NUM_PIECE_TYPES);
+    printf("const int THREAT_BY_PAWN_MG = %d;\n", rounded(mg[at(&t.threatByPawn)]));
+    printf("const int THREAT_BY_PAWN_EG = %d;\n", rounded(eg[at(&t.threatByPawn)]));
+    printf("const int HANGING_MG = %d;\n", rounded(mg[at(&t.hanging)]));
+    printf("const int HANGING_EG = %d;\n", rounded(eg[at(&t.hanging)]));
+    printTable("MG_TABLE", &mg[at(t.psq[0])]);
+    printTable("EG_TABLE", &eg[at(t.psq[0])]);
+
+    printf("\n// Pawns.cpp\n");
+    printf("const int DOUBLED_MG = %d, DOUBLED_EG = %d;\n", rounded(mg[at(&t.doubled)]), rounded(eg[at(&t.doubled)]));
+    printf("const int ISOLATED_MG = %d, ISOLATED_EG = %d;\n", rounded(mg[at(&t.isolated)]), rounded(eg[at(&t.isolated)]));
+    printf("const int BACKWARD_MG = %d, BACKWARD_EG = %d;\n", rounded(mg[at(&t.backward)]), rounded(eg[at(&t.backward)]));
+    printArray("PASSED_MG", &mg[at(t.passed)], 8);
+    printArray("PASSED_EG", &eg[at(t.passed)], 8);
+    printf("const int SHIELD_ONE_AHEAD = %d;\n", rounded(mg[at(&t.shieldOneAhead)]));
+    printf("const int SHIELD_TWO_AHEAD = %d;\n", rounded(mg[at(&t.shieldTwoAhead)]));
+    printf("const int SHIELD_MISSING = %d;\n", rounded(mg[at(&t.shieldMissing)]));
+
+    printf("\n// Material.cpp\n");
+    printf("const int BISHOP_PAIR_MG = %d, BISHOP_PAIR_EG = %d;\n", rounded(mg[at(&t.bishopPair)]), rounded(eg[at(&t.bishopPair)]));
+    printf("const int KNIGHT_PER_PAWN = %d;\n", rounded(mg[at(&t.knightPerPawn)]));
+    printf("const int ROOK_PER_PAWN = %d;\n", rounded(mg[at(&t.rookPerPawn)]));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+// main
+////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s positions.bin|positions.epd [epochs] [threads]\n", argv[0]);
+        return 1;
+    }
+    int epochs = argc > 2 ? atoi(argv[2]) : DEFAULT_EPOCHS;
+    int threads = max(1, argc > 3 ? atoi(argv[3]) : (int)thread::hardware_concurrency());
+
+    Dataset data;
+    auto start = chrono::steady_clock::now();
+    if (!loadDataset(argv[1], threads, data))
+    {
+        return 1;
+    }
+    chrono::duration<double> loadTime = chrono::steady_clock::now() - start;
+    printf("loaded in %.1f s\n", loadTime.count());
+
+    // Start from the weights in the source
+    EvalTerms mgTerms, egTerms;
+    evalWeights(mgTerms, egTerms);
+    vector<double> mg(NUM_EVAL_TERMS), eg(NUM_EVAL_TERMS);
+    for (int i = 0; i < NUM_EVAL_TERMS; i++)
+    {
+        mg[i] = reinterpret_cast<const int*>(&mgTerms)[i];
+        eg[i] = reinterpret_cast<const int*>(&egTerms)[i];
+    }
+    vector<TermKind> kinds = termKinds();
+
+    double k = findK(data, threads, mg.data(), eg.data());
+    printf("K = %.4f, error %.6f\n", k, totalError(data, threads, k, mg.data(), eg.data(), nullptr, nullptr));
+
+    // Full batch Adam: every epoch takes one step along the gradient over the whole set
+    vector<double> m1Mg(NUM_EVAL_TERMS, 0.0), m1Eg(NUM_EVAL_TERMS, 0.0);
+    vector<double> m2Mg(NUM_EVAL_TERMS, 0.0), m2Eg(NUM_EVAL_TERMS, 0.0);
+    start = chrono::steady_clock::now();
+    for (int epoch = 1; epoch <= epochs; epoch++)
+    {
+        vector<double> gradMg(NUM_EVAL_TERMS, 0.0), gradEg(NUM_EVAL_TERMS, 0.0);
+        double error = totalError(data, threads, k, mg.data(), eg.data(), &gradMg, &gradEg);
+
+        for (int i = 0; i < NUM_EVAL_TERMS; i++)
+        {
+            switch (kinds[i])
+            {
+                case TERM_MG_ONLY: gradEg[i] = 0; break;
+                case TERM_EG_ONLY: gradMg[i] = 0; break;
+                case TERM_TIED:    gradMg[i] = gradEg[i] = gradMg[i] + gradEg[i]; break;
+                case TERM_BOTH:    break;
+            }
+            double correction1 = 1 - pow(BETA1, epoch);
+            double correction2 = 1 - pow(BETA2, epoch);
+            m1Mg[i] = BETA1 * m1Mg[i] + (1 - BETA1) * gradMg[i];
+            m1Eg[i] = BETA1 * m1Eg[i] + (1 - BETA1) * gradEg[i];
+            m2Mg[i] = BETA2 * m2Mg[i] + (1 - BETA2) * gradMg[i] * gradMg[i];
+            m2Eg[i] = BETA2 * m2Eg[i] + (1 - BETA2) * gradEg[i] * gradEg[i];
+            mg[i] -= LEARNING_RATE * (m1Mg[i] / correction1) / (sqrt(m2Mg[i] / correction2) + 1e-8);
+            eg[i] -= LEARNING_RATE * (m1Eg[i] / correction1) / (sqrt(m2Eg[i] / correction2) + 1e-8);
+        }
+
+        if (epoch % REPORT_EVERY == 0 || epoch == epochs)
+        {
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            printf("epoch %5d  error %.6f  %.1fM positions/s\n", epoch, error,
+                   epoch * double(data.positions.size()) / elapsed.count() / 1e6);
+            fflush(stdout);
+        }
+    }
+
+    printWeights(mg.data(), eg.data());
+    return 0;
+}